@@ -7,8 +7,13 @@
  * @date March, 2020
  */
 
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
+#include <memory>
 #include <string>
+#include <thread>
+#include <sstream>
 
 // Uses cxxopts from https://github.com/jarro2783/cxxopts under the MIT license
 #include "cxxopts/cxxopts.hxx"
@@ -16,6 +21,9 @@
 #include "grid.h"
 #include "world.h"
 #include "zoo.h"
+#include "snapshotqueue.h"
+#include "checkpointwriter.h"
+#include "resources.h"
 
 int main(int argc, char *argv[]) {
 
@@ -28,7 +36,18 @@ int main(int argc, char *argv[]) {
             ("o,output", "Save an ascii file to the provided path.",  cxxopts::value<std::string>())
             ("s,steps","The number of steps to simulate the world.", cxxopts::value<int>()->default_value("10"))
             ("e,every","Print world to the console every N steps. 0 disables printing.", cxxopts::value<int>()->default_value("0"))
+            ("queue", "Buffer up to N snapshots waiting to be printed by --every.", cxxopts::value<int>()->default_value("2"))
+            ("drop", "When the print queue is full, 'block' the simulation or 'skip' the stalest snapshot.", cxxopts::value<std::string>()->default_value("block"))
             ("t,toroidal", "Simulate the Game of Life on a torus.", cxxopts::value<bool>()->default_value("false"))
+            ("r,rule", "Step with the given B/S rulestring, e.g. B36/S23 for HighLife.", cxxopts::value<std::string>()->default_value("B3/S23"))
+            ("hashlife", "Advance with the HashLife engine, treating the world as a window onto an unbounded plane.", cxxopts::value<bool>()->default_value("false"))
+            ("stable", "Stop stepping early once the world repeats an earlier state, skipping to the same phase of the cycle. Not with --every.", cxxopts::value<bool>()->default_value("false"))
+            ("checkpoint", "Save a checkpoint to the provided path every --checkpoint-every steps, from a background thread.", cxxopts::value<std::string>())
+            ("checkpoint-every", "The number of steps between checkpoints.", cxxopts::value<int>()->default_value("100000"))
+            ("resume", "Restore the world from a checkpoint at the provided path and carry on until --steps steps in total.", cxxopts::value<std::string>())
+            ("j,threads", "Step the world on N threads. 0 uses one thread per core.", cxxopts::value<int>()->default_value("1"))
+            ("numa", "Pin the stepping threads to cores and place each band of the world on the NUMA node of the thread stepping it.", cxxopts::value<bool>()->default_value("false"))
+            ("memory", "Allocate grids from the 'heap', from 'aligned' cache lines, or on 'huge' pages.", cxxopts::value<std::string>()->default_value("heap"))
             ("h,help", "Print usage.");
 
     // Actually parse the command line arguments
@@ -43,7 +62,39 @@ int main(int argc, char *argv[]) {
     // Parse the (potentially defaulted) parameters for this simulation
     const int  steps    = result["steps"].as<int>();
     const int  every    = result["every"].as<int>();
-    const bool toroidal = result["toroidal"].as<bool>();
+    bool       toroidal = result["toroidal"].as<bool>();
+    const int  threads  = result["threads"].as<int>();
+    const bool hashlife = result["hashlife"].as<bool>();
+    const bool stable   = result["stable"].as<bool>();
+    const bool numa     = result["numa"].as<bool>();
+    const int  queued   = result["queue"].as<int>();
+    const std::string drop = result["drop"].as<std::string>();
+    const int  checkpoint_every = std::max(1, result["checkpoint-every"].as<int>());
+    const std::string memory = result["memory"].as<std::string>();
+    if (drop != "block" && drop != "skip") {
+        std::cerr << "--drop must be 'block' or 'skip'" << std::endl;
+        std::exit(-1);
+    }
+    if (memory != "heap" && memory != "aligned" && memory != "huge") {
+        std::cerr << "--memory must be 'heap', 'aligned' or 'huge'" << std::endl;
+        std::exit(-1);
+    }
+    if (hashlife && toroidal) {
+        std::cerr << "--hashlife runs on an unbounded plane and cannot be combined with --toroidal" << std::endl;
+        std::exit(-1);
+    }
+    if (stable && every > 0) {
+        std::cerr << "--stable skips the steps --every would print, so it cannot be combined with --every" << std::endl;
+        std::exit(-1);
+    }
+
+    // Every grid made from here on, including those of the world, is allocated from the chosen resource
+    if (memory == "aligned") {
+        std::pmr::set_default_resource(aligned_resource());
+    }
+    else if (memory == "huge") {
+        std::pmr::set_default_resource(huge_page_resource());
+    }
 
     // Start with an empty grid
     Grid grid;
@@ -59,34 +110,165 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    // Parse the rule to simulate
+    Rule rule;
+    try {
+        rule = Rule::parse(result["rule"].as<std::string>());
+    }
+    catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        std::exit(-1);
+    }
+
     // Construct a world from the parsed grid
-    World world(grid);
+    World world(grid, hashlife ? Engine::HASHLIFE : Engine::WINDOW);
+    try {
+        world.set_rule(rule);
+    }
+    catch (const std::exception &ex) {
+        std::cerr << ex.what() << std::endl;
+        std::exit(-1);
+    }
+
+    // Split each step across a thread pool if more than one thread, or NUMA placement, was requested
+    if ((threads != 1 || numa) && !hashlife) {
+        world.set_engine(Engine::PARALLEL);
+        world.set_numa(numa);
+        world.set_threads((threads > 0) ? threads : std::thread::hardware_concurrency());
+    }
+
+    // Carry on from a checkpoint if one was given, in place of the input file, with its rule and topology
+    if (result.count("resume")) {
+        try {
+            world.restore(result["resume"].as<std::string>());
+        }
+        catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+            std::exit(-1);
+        }
+        if (world.get_generation() > 0) {
+            toroidal = world.get_toroidal();
+        }
+        if (hashlife && toroidal) {
+            std::cerr << "The checkpoint was stepped on a torus, which --hashlife cannot continue" << std::endl;
+            std::exit(-1);
+        }
+        std::cout << "Resumed from step " << world.get_generation() << std::endl;
+    }
+    const int remaining = (int)std::max<int64_t>(0, steps - world.get_generation());
+
+    // Checkpoints are serialised in memory here and written out by a background thread
+    std::unique_ptr<CheckpointWriter> writer;
+    if (result.count("checkpoint")) {
+        writer = std::make_unique<CheckpointWriter>(result["checkpoint"].as<std::string>());
+    }
+    int64_t last_checkpoint = -1;
+    auto save_checkpoint = [&]() {
+        std::ostringstream buffer;
+        world.checkpoint(buffer);
+        writer->submit(buffer.str(), world.get_generation());
+        last_checkpoint = world.get_generation();
+    };
 
     // Print the initial state of the grid
     std::cout << "Initial state..." << std::endl
               << "Alive " << world.get_alive_cells() << " | Dead " << world.get_dead_cells()  << std::endl
-              << world.get_state() << std::endl;
+              << world.view() << std::endl;
+
+    // Perform the requested number of update steps, all at once if nothing is printed along the way
+    if (every == 0 && stable) {
+        // Look for a cycle a chunk at a time, checkpointing between the chunks if checkpoints were asked for
+        const int chunk = writer ? checkpoint_every : std::max(1, remaining);
+        for (int done = 0; done < remaining; ) {
+            const int64_t start = world.get_generation();
+            Cycle cycle = world.advance_until_stable(std::min(chunk, remaining - done), toroidal);
+            if (cycle.period > 0) {
+                // Once the world cycles, only step far enough to reach the phase the last step would have been in
+                int left = remaining - done - cycle.first - cycle.period;
+                world.advance(left % cycle.period, toroidal);
+                std::cout << "Stable with period " << cycle.period << " from step " << start + cycle.first
+                          << ", skipped " << (left - left % cycle.period) << " steps" << std::endl;
+                break;
+            }
+            done += std::min(chunk, remaining - done);
+            if (writer) {
+                save_checkpoint();
+            }
+        }
+    }
+    else if (every == 0 && writer) {
+        // Advance in chunks, checkpointing between them
+        for (int done = 0; done < remaining; done += checkpoint_every) {
+            world.advance(std::min(checkpoint_every, remaining - done), toroidal);
+            save_checkpoint();
+        }
+    }
+    else if (every == 0) {
+        world.advance(remaining, toroidal);
+    }
+    if (every > 0) {
+        // Snapshots are printed by an output thread, so a slow terminal or disk does not stall the simulation
+        SnapshotQueue queue((queued > 0) ? queued : 1, (drop == "skip") ? DropPolicy::SKIP_STALE : DropPolicy::BLOCK);
+        std::thread output([&]() {
+            Snapshot snapshot;
+            std::ostringstream frame;
+            while (queue.pop(snapshot)) {
+                frame.str("");
+                frame << "Step " << snapshot.step << " of " << steps << "\n" << snapshot.state << "\n";
+                std::cout << frame.str() << std::flush;
+            }
+        });
+        for (int step = steps - remaining; step < steps; step++) {
+            world.step(toroidal);
 
-    // Perform the requested number of update steps
-    for (int step = 0; step < steps; step++) {
-        world.step(toroidal);
+            // Publish the state of the grid every N steps
+            if (step % every == 0) {
+                queue.push(Snapshot{step + 1, world.get_state()});
+            }
+            if (writer && (step + 1) % checkpoint_every == 0) {
+                save_checkpoint();
+            }
+        }
+        queue.close();
+        output.join();
+        if (queue.get_dropped() > 0) {
+            std::cout << "Skipped printing " << queue.get_dropped() << " stale snapshots" << std::endl;
+        }
+    }
 
-        // Print the state of the grid every N steps
-        if ((every > 0) && (step % every == 0)) {
-            std::cout << "Step " << (step + 1) << " of " << steps << std::endl
-                      << world.get_state() << std::endl;
+    // Save the final state too, and wait for the last checkpoint to reach the disk
+    if (writer) {
+        if (last_checkpoint != world.get_generation()) {
+            save_checkpoint();
+        }
+        writer->close();
+        if (!writer->get_error().empty()) {
+            std::cerr << writer->get_error() << std::endl;
         }
     }
 
     // Print the final state of the grid
     std::cout << "Final state..." << std::endl
               << "Alive " << world.get_alive_cells() << " | Dead " << world.get_dead_cells()  << std::endl
-              << world.get_state() << std::endl;
+              << world.view() << std::endl;
+
+    // Report which NUMA nodes the memory of the world landed on
+    if (numa && !hashlife) {
+        try {
+            std::vector<size_t> nodes = world.get_placement();
+            for (size_t node = 0; node < nodes.size(); node++) {
+                std::cout << "Node " << node << ": " << nodes[node] / 1024 << " KB" << std::endl;
+            }
+        }
+        catch (const std::exception &ex) {
+            std::cerr << ex.what() << std::endl;
+        }
+    }
 
     // Attempt to save to the output directory if a path was given
     if (result.count("output")) {
         try {
-            Zoo::save_ascii(result["output"].as<std::string>(), world.get_state());
+            Zoo::save_ascii(result["output"].as<std::string>(), world.view());
         }
         catch (const std::exception &ex) {
             std::cerr << ex.what() << std::endl;
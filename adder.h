@@ -0,0 +1,69 @@
+/**
+ * Declares the bitwise adder logic shared by the kernels that step 64 cells per uint64_t word.
+ *      - Bit i of every word is an independent lane, so one call adds 64 neighbour counts at once.
+ *      - Engine::BITWISE uses the lanes for 64 neighbouring cells of one world.
+ *      - BitSlice uses the lanes for the same cell of 64 different worlds.
+ */
+#pragma once
+#include <cstdint>
+
+/**
+ * full_add(a, b, c, sum, carry)
+ *
+ * Adds three words bit by bit, as 64 independent one bit full adders.
+ *
+ * @param a, b, c
+ *      The words to add.
+ *
+ * @param sum
+ *      Set to the ones bit of each of the 64 sums.
+ *
+ * @param carry
+ *      Set to the twos bit of each of the 64 sums.
+ */
+
+inline void full_add(uint64_t a, uint64_t b, uint64_t c, uint64_t& sum, uint64_t& carry){
+  uint64_t t=a^b;
+  sum=t^c;
+  carry=(a&b)|(t&c);
+}
+
+/**
+ * sum_neighbours(upWest, up, upEast, west, east, downWest, down, downEast, bit0, bit1, bit2, bit3)
+ *
+ * Adds the eight neighbours of 64 lanes bit by bit into four bit planes of their neighbour counts.
+ * The three words above and the three below are summed by full adders, the two beside by a half adder,
+ * and the three partial sums are combined by a final tree of adders.
+ *
+ * @param upWest, up, upEast
+ *      The neighbours above to the west, directly above, and above to the east.
+ *
+ * @param west, east
+ *      The neighbours to the west and to the east.
+ *
+ * @param downWest, down, downEast
+ *      The neighbours below to the west, directly below, and below to the east.
+ *
+ * @param bit0, bit1, bit2, bit3
+ *      Set to the ones, twos, fours and eights bits of the neighbour count of each lane.
+ */
+
+inline void sum_neighbours(uint64_t upWest, uint64_t up, uint64_t upEast, uint64_t west, uint64_t east,
+                           uint64_t downWest, uint64_t down, uint64_t downEast,
+                           uint64_t& bit0, uint64_t& bit1, uint64_t& bit2, uint64_t& bit3){
+  //Sum the three cells above and the three cells below
+  uint64_t upOnes, upTwos, downOnes, downTwos;
+  full_add(upWest, up, upEast, upOnes, upTwos);
+  full_add(downWest, down, downEast, downOnes, downTwos);
+  //Sum the cells to the left and right
+  uint64_t midOnes=west^east;
+  uint64_t midTwos=west&east;
+  //Combine the partial sums into the count bits
+  uint64_t twos, twosSum, fours;
+  full_add(upOnes, downOnes, midOnes, bit0, twos);
+  full_add(upTwos, downTwos, midTwos, twosSum, fours);
+  bit1=twosSum^twos;
+  uint64_t moreFours=twosSum&twos;
+  bit2=fours^moreFours;
+  bit3=fours&moreFours;
+}
@@ -0,0 +1,318 @@
+/**
+ * Implements a class representing a bit-packed 2d grid of cells.
+ *      - Cells are stored one bit each, 64 cells to a uint64_t word, so a grid takes 1/8 of the memory of a Grid.
+ *      - New cells are initialized to Cell::DEAD (a 0 bit).
+ *      - BitGrids can be built from a Grid and converted back into a Grid.
+ *      - Rows are exposed as raw word pointers so step kernels can update 64 cells at a time.
+ */
+#include <bitset>
+#include "bitgrid.h"
+
+/**
+ * BitGrid::BitGrid()
+ *
+ * Construct an empty bit grid of size 0x0.
+ *
+ * @example
+ *
+ *      // Make a 0x0 empty bit grid
+ *      BitGrid grid;
+ *
+ */
+
+BitGrid::BitGrid():width(0), height(0), words_per_row(0){}
+
+/**
+ * BitGrid::BitGrid(width, height)
+ *
+ * Construct a bit grid with the desired size filled with dead cells.
+ *
+ * @example
+ *
+ *      // Make a 16x9 bit grid
+ *      BitGrid grid(16, 9);
+ *
+ * @param width
+ *      The width of the grid.
+ *
+ * @param height
+ *      The height of the grid.
+ */
+
+BitGrid::BitGrid(int width, int height):width(width), height(height), words_per_row((width+63)/64){
+  this->words.assign(this->words_per_row*height, 0);
+}
+
+/**
+ * BitGrid::BitGrid(grid)
+ *
+ * Construct a bit grid holding the same size and cells as a Grid.
+ *
+ * @example
+ *
+ *      // Pack a glider into a bit grid
+ *      BitGrid grid(Zoo::glider());
+ *
+ * @param grid
+ *      The grid to pack.
+ */
+
+BitGrid::BitGrid(const Grid& grid):BitGrid(grid.get_width(), grid.get_height()){
+  for (int y=0; y<this->height; y++){
+    const Cell* cells=grid.row(y);
+    uint64_t* out=this->row(y);
+    for (int x=0; x<this->width; x++){
+      if (cells[x]==Cell::ALIVE){
+        out[x/64]|=(uint64_t)1<<(x%64);
+      }
+    }
+  }
+}
+
+BitGrid::~BitGrid(){ }
+
+/**
+ * BitGrid::get_width()
+ *
+ * Gets the current width of the bit grid.
+ *
+ * @return
+ *      The width of the grid.
+ */
+
+int BitGrid::get_width() const{
+  return this->width;
+}
+
+/**
+ * BitGrid::get_height()
+ *
+ * Gets the current height of the bit grid.
+ *
+ * @return
+ *      The height of the grid.
+ */
+
+int BitGrid::get_height() const{
+  return this->height;
+}
+
+/**
+ * BitGrid::get_words_per_row()
+ *
+ * Gets the number of uint64_t words used to store each row.
+ *
+ * @return
+ *      The number of words in a row.
+ */
+
+int BitGrid::get_words_per_row() const{
+  return this->words_per_row;
+}
+
+/**
+ * BitGrid::get_total_cells()
+ *
+ * Gets the total number of cells in the bit grid.
+ *
+ * @return
+ *      The number of total cells.
+ */
+
+int BitGrid::get_total_cells() const{
+  return this->width*this->height;
+}
+
+/**
+ * BitGrid::get_alive_cells()
+ *
+ * Counts how many cells in the bit grid are alive by counting the set bits of every word.
+ *
+ * @return
+ *      The number of alive cells.
+ */
+
+int BitGrid::get_alive_cells() const{
+  int alive=0;
+  for (uint64_t word : this->words){
+    alive+=std::bitset<64>(word).count();
+  }
+  return alive;
+}
+
+/**
+ * BitGrid::get_dead_cells()
+ *
+ * Counts how many cells in the bit grid are dead.
+ *
+ * @return
+ *      The number of dead cells.
+ */
+
+int BitGrid::get_dead_cells() const{
+  return this->get_total_cells()-this->get_alive_cells();
+}
+
+/**
+ * BitGrid::get(x, y)
+ *
+ * Returns the value of the cell at the desired coordinate.
+ *
+ * @example
+ *
+ *      // Make a bit grid
+ *      BitGrid grid(4, 4);
+ *
+ *      // Read the cell at coordinate (1, 2)
+ *      Cell cell = grid.get(1, 2);
+ *
+ * @param x
+ *      The x coordinate of the cell.
+ *
+ * @param y
+ *      The y coordinate of the cell.
+ *
+ * @return
+ *      The value of the desired cell.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the grid.
+ */
+
+Cell BitGrid::get(int x, int y) const{
+  if (x<0 || y<0 || x>=this->width || y>=this->height){
+    throw "NOPE";
+  }
+  if ((this->row(y)[x/64]>>(x%64))&1){
+    return Cell::ALIVE;
+  }
+  return Cell::DEAD;
+}
+
+/**
+ * BitGrid::set(x, y, value)
+ *
+ * Overwrites the value at the desired coordinate.
+ *
+ * @example
+ *
+ *      // Make a bit grid
+ *      BitGrid grid(4, 4);
+ *
+ *      // Assign to a cell at coordinate (1, 2)
+ *      grid.set(1, 2, Cell::ALIVE);
+ *
+ * @param x
+ *      The x coordinate of the cell to update.
+ *
+ * @param y
+ *      The y coordinate of the cell to update.
+ *
+ * @param value
+ *      The value to be written to the selected cell.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the grid.
+ */
+
+void BitGrid::set(int x, int y, Cell c){
+  if (x<0 || y<0 || x>=this->width || y>=this->height){
+    throw "Setting out of bounds";
+  }
+  uint64_t bit=(uint64_t)1<<(x%64);
+  if (c==Cell::ALIVE){
+    this->row(y)[x/64]|=bit;
+  }
+  else{
+    this->row(y)[x/64]&=~bit;
+  }
+}
+
+/**
+ * BitGrid::row(y)
+ *
+ * Gets a pointer to the first word of a row. There are BitGrid::get_words_per_row() words in each row.
+ *
+ * @param y
+ *      The y coordinate of the row.
+ *
+ * @return
+ *      A pointer to the words of the row.
+ */
+
+const uint64_t* BitGrid::row(int y) const{
+  return this->words.data()+(y*this->words_per_row);
+}
+
+uint64_t* BitGrid::row(int y){
+  return this->words.data()+(y*this->words_per_row);
+}
+
+/**
+ * BitGrid::last_word_mask()
+ *
+ * Gets the mask of the bits in the last word of each row that hold cells.
+ * Kernels writing whole words must AND the last word of a row with this mask to keep the padding bits 0.
+ *
+ * @return
+ *      A mask with one bit set for each cell stored in the last word of a row.
+ */
+
+uint64_t BitGrid::last_word_mask() const{
+  int bits=this->width%64;
+  if (bits==0){
+    return ~(uint64_t)0;
+  }
+  return ((uint64_t)1<<bits)-1;
+}
+
+/**
+ * BitGrid::to_grid()
+ *
+ * Unpack the bit grid into a Grid of the same size.
+ *
+ * @example
+ *
+ *      // Print a bit grid to the console
+ *      std::cout << bits.to_grid() << std::endl;
+ *
+ * @return
+ *      A Grid holding the same cells.
+ */
+
+Grid BitGrid::to_grid() const{
+  Grid result(this->width, this->height);
+  this->to_grid(result);
+  return result;
+}
+
+/**
+ * BitGrid::to_grid(result)
+ *
+ * Unpack the bit grid into an existing Grid of the same size, overwriting every cell in place.
+ * Converting into the same Grid every generation allocates nothing once its cells are no longer shared.
+ *
+ * @example
+ *
+ *      // Unpack a bit grid after every step into one Grid
+ *      Grid cells(bits.get_width(), bits.get_height());
+ *      bits.to_grid(cells);
+ *
+ * @param result
+ *      The grid to unpack into, the same size as the bit grid.
+ */
+
+void BitGrid::to_grid(Grid& result) const{
+  result.renew(BulkKey());
+  int alive=0;
+  for (int y=0; y<this->height; y++){
+    const uint64_t* in=this->row(y);
+    Cell* out=result.row_data(y, BulkKey());
+    for (int x=0; x<this->width; x++){
+      bool bit=(in[x/64]>>(x%64))&1;
+      out[x]=bit ? Cell::ALIVE : Cell::DEAD;
+      alive+=bit;
+    }
+  }
+  result.set_alive_cells(alive, BulkKey());
+}
@@ -0,0 +1,46 @@
+/**
+ * Declares a class representing a bit-packed 2d grid of cells.
+ * Rich documentation for the api and behaviour the BitGrid class can be found in bitgrid.cpp.
+ */
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "grid.h"
+
+/**
+ * Declare the structure of the BitGrid class for representing a 2d grid of cells packed 64 to a word.
+ *
+ * Each row is stored as (width + 63) / 64 uint64_t words, bit i of word j holding the cell at x = j * 64 + i.
+ * Bits past the width in the last word of a row are always 0.
+ */
+class BitGrid {
+  private:
+    int width;
+    int height;
+    int words_per_row;
+    std::vector<uint64_t> words;
+
+  public:
+    BitGrid();
+    BitGrid(int width, int height);
+    explicit BitGrid(const Grid& grid);
+    BitGrid(const BitGrid& other) = default;
+    BitGrid(BitGrid&& other) noexcept = default;
+    BitGrid& operator=(const BitGrid& other) = default;
+    BitGrid& operator=(BitGrid&& other) noexcept = default;
+    ~BitGrid();
+
+    int get_height() const;
+    int get_width() const;
+    int get_words_per_row() const;
+    int get_total_cells() const;
+    int get_alive_cells() const;
+    int get_dead_cells() const;
+    Cell get(int x, int y) const;
+    void set(int x, int y, Cell c);
+    const uint64_t* row(int y) const;
+    uint64_t* row(int y);
+    uint64_t last_word_mask() const;
+    Grid to_grid() const;
+    void to_grid(Grid& result) const;
+};
@@ -0,0 +1,399 @@
+/**
+ * Implements a class representing 64 independent, equally sized worlds sliced across the bits of one word per cell.
+ *      - The cell at x,y of world k is bit k of word y * width + x, so every world fits in one buffer.
+ *      - Worlds are built from ordinary Grid objects and decomposed back into them.
+ *      - New worlds are filled with dead cells.
+ *
+ *      - Stepping a slice advances all 64 worlds at once.
+ *          - The eight neighbour words of a cell are summed with the bitwise adders of adder.h into four bit planes,
+ *            one neighbour count per world, and Rule::next_bits applies the rule to all the worlds together.
+ *          - Updating the worlds can conditionally be performed using a toroidal topology.
+ */
+#include <stdexcept>
+#include <utility>
+#include "bitslice.h"
+#include "adder.h"
+
+/**
+ * BitSlice::BitSlice()
+ *
+ * Construct an empty slice of 64 worlds of size 0x0.
+ *
+ * @example
+ *
+ *      // Make an empty slice
+ *      BitSlice slice;
+ *
+ */
+
+BitSlice::BitSlice():width(0), height(0){}
+
+/**
+ * BitSlice::BitSlice(width, height)
+ *
+ * Construct a slice of 64 worlds of the desired size filled with dead cells.
+ *
+ * @example
+ *
+ *      // Make 64 worlds of 32x32 cells
+ *      BitSlice slice(32, 32);
+ *
+ * @param width
+ *      The width of every world.
+ *
+ * @param height
+ *      The height of every world.
+ */
+
+BitSlice::BitSlice(int width, int height):width(width), height(height){
+  this->currCells.assign(width*height, 0);
+  this->newCells.assign(width*height, 0);
+}
+
+/**
+ * BitSlice::BitSlice(worlds)
+ *
+ * Construct a slice from up to 64 grids of the same size. World k of the slice starts as grid k,
+ * and any worlds past the last grid start empty.
+ *
+ * @example
+ *
+ *      // Slice 64 random soups together
+ *      std::vector<Grid> soups = ...;
+ *      BitSlice slice(soups);
+ *
+ * @param worlds
+ *      The initial states of the worlds.
+ *
+ * @throws
+ *      std::runtime_error if there are no grids, more than 64 grids, or the grids differ in size.
+ */
+
+BitSlice::BitSlice(const std::vector<Grid>& worlds){
+  if (worlds.empty() || (int)worlds.size()>WORLDS){
+    throw std::runtime_error("A bit slice holds from 1 to 64 worlds");
+  }
+  this->width=worlds[0].get_width();
+  this->height=worlds[0].get_height();
+  this->currCells.assign(this->width*this->height, 0);
+  this->newCells.assign(this->width*this->height, 0);
+  for (int k=0; k<(int)worlds.size(); k++){
+    this->load(k, worlds[k]);
+  }
+}
+
+BitSlice::~BitSlice(){ }
+
+/**
+ * BitSlice::get_width()
+ *
+ * Gets the width of every world in the slice.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The width of the worlds.
+ */
+
+int BitSlice::get_width() const{
+  return this->width;
+}
+
+/**
+ * BitSlice::get_height()
+ *
+ * Gets the height of every world in the slice.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The height of the worlds.
+ */
+
+int BitSlice::get_height() const{
+  return this->height;
+}
+
+/**
+ * BitSlice::check_world(world)
+ *
+ * Private helper function to check a world index is in the slice.
+ *
+ * @param world
+ *      The index of the world.
+ *
+ * @throws
+ *      std::runtime_error if the index is not in [0, 64).
+ */
+
+void BitSlice::check_world(int world) const{
+  if (world<0 || world>=WORLDS){
+    throw std::runtime_error("A bit slice only has worlds 0 to 63");
+  }
+}
+
+/**
+ * BitSlice::get_state(world)
+ *
+ * Decompose one world of the slice back into a Grid.
+ *
+ * @param world
+ *      The index of the world, from 0 to 63.
+ *
+ * @return
+ *      A grid holding the current state of the world.
+ *
+ * @throws
+ *      std::runtime_error if the index is not in [0, 64).
+ */
+
+Grid BitSlice::get_state(int world) const{
+  this->check_world(world);
+  Grid result(this->width, this->height);
+  int alive=0;
+  for (int y=0; y<this->height; y++){
+    const uint64_t* cells=this->currCells.data()+y*this->width;
+    Cell* row=result.row_data(y, BulkKey());
+    for (int x=0; x<this->width; x++){
+      bool set=(cells[x]>>world)&1;
+      row[x]=set ? Cell::ALIVE : Cell::DEAD;
+      alive+=set;
+    }
+  }
+  result.set_alive_cells(alive, BulkKey());
+  return result;
+}
+
+/**
+ * BitSlice::load(world, state)
+ *
+ * Replace one world of the slice with the cells of a Grid of the same size.
+ *
+ * @param world
+ *      The index of the world, from 0 to 63.
+ *
+ * @param state
+ *      The new state of the world.
+ *
+ * @throws
+ *      std::runtime_error if the index is out of range or the grid is not the size of the worlds.
+ */
+
+void BitSlice::load(int world, const Grid& state){
+  this->check_world(world);
+  if (state.get_width()!=this->width || state.get_height()!=this->height){
+    throw std::runtime_error("Grid size does not match the bit slice");
+  }
+  uint64_t bit=(uint64_t)1<<world;
+  for (int y=0; y<this->height; y++){
+    const Cell* row=state.row(y);
+    uint64_t* cells=this->currCells.data()+y*this->width;
+    for (int x=0; x<this->width; x++){
+      if (row[x]==Cell::ALIVE){
+        cells[x]|=bit;
+      }
+      else{
+        cells[x]&=~bit;
+      }
+    }
+  }
+}
+
+/**
+ * BitSlice::get_states()
+ *
+ * Decompose every world of the slice back into Grid objects.
+ *
+ * @return
+ *      The 64 worlds, world k at index k.
+ */
+
+std::vector<Grid> BitSlice::get_states() const{
+  std::vector<Grid> result;
+  for (int k=0; k<WORLDS; k++){
+    result.push_back(this->get_state(k));
+  }
+  return result;
+}
+
+/**
+ * BitSlice::get_alive_cells(world)
+ *
+ * Count the alive cells of one world of the slice.
+ *
+ * @param world
+ *      The index of the world, from 0 to 63.
+ *
+ * @return
+ *      The number of alive cells.
+ *
+ * @throws
+ *      std::runtime_error if the index is not in [0, 64).
+ */
+
+int BitSlice::get_alive_cells(int world) const{
+  this->check_world(world);
+  int alive=0;
+  for (uint64_t cell : this->currCells){
+    alive+=(cell>>world)&1;
+  }
+  return alive;
+}
+
+/**
+ * BitSlice::get_alive_cells()
+ *
+ * Count the alive cells of every world of the slice in one pass, only visiting the bits that are set.
+ *
+ * @return
+ *      The 64 alive counts, world k at index k.
+ */
+
+std::vector<int> BitSlice::get_alive_cells() const{
+  std::vector<int> alive(WORLDS, 0);
+  for (uint64_t cell : this->currCells){
+    while (cell!=0){
+      alive[__builtin_ctzll(cell)]++;
+      cell&=cell-1;
+    }
+  }
+  return alive;
+}
+
+/**
+ * BitSlice::get_rule()
+ *
+ * Gets the rule every world of the slice is stepped with.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The current rule.
+ */
+
+Rule BitSlice::get_rule() const{
+  return this->rule;
+}
+
+/**
+ * BitSlice::set_rule(rule)
+ *
+ * Change the rule every world of the slice is stepped with from the next step onwards.
+ *
+ * @param rule
+ *      The new rule.
+ */
+
+void BitSlice::set_rule(const Rule& rule){
+  this->rule=rule;
+}
+
+/**
+ * BitSlice::step(toroidal)
+ *
+ * Take one step of all 64 worlds.
+ *
+ * Reads from the current state buffer and writes to the next state buffer, then swaps them.
+ * The eight neighbour words of each cell are summed by sum_neighbours into four bit planes holding a neighbour
+ * count per world, and Rule::next_bits applies the rule to all 64 worlds at once. Neighbours outside a bounded
+ * world read as 0, dead in every world.
+ *
+ * Conway's rule is applied by the kernel specialised for ConwayRule.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider every world as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ */
+
+void BitSlice::step(bool toroidal){
+  if (this->rule==ConwayRule::rule){
+    this->step(toroidal, ConwayRule());
+  }
+  else{
+    this->step(toroidal, this->rule);
+  }
+}
+
+/**
+ * BitSlice::step(toroidal, transition)
+ *
+ * Private helper function to take one step of all 64 worlds with the rule of a given type.
+ *
+ * @param toroidal
+ *      If true then the step will consider every world as a torus.
+ *
+ * @param transition
+ *      The rule of the worlds, either as a Rule or as a StaticRule fixing it at compile time.
+ */
+
+template <typename Transition>
+void BitSlice::step(bool toroidal, const Transition& transition){
+  int width=this->width;
+  int height=this->height;
+  if (width==0 || height==0){
+    return;
+  }
+  //The word at column x of a row, wrapped on a torus, or 0 past a bounded edge
+  auto at=[&](const uint64_t* row, int x) -> uint64_t{
+    if (row==nullptr){
+      return 0;
+    }
+    if (x<0){
+      return toroidal ? row[width-1] : 0;
+    }
+    if (x>=width){
+      return toroidal ? row[0] : 0;
+    }
+    return row[x];
+  };
+  for (int y=0; y<height; y++){
+    const uint64_t* up=nullptr;
+    const uint64_t* down=nullptr;
+    if (y>0){
+      up=this->currCells.data()+(y-1)*width;
+    }
+    else if (toroidal){
+      up=this->currCells.data()+(height-1)*width;
+    }
+    if (y<height-1){
+      down=this->currCells.data()+(y+1)*width;
+    }
+    else if (toroidal){
+      down=this->currCells.data();
+    }
+    const uint64_t* mid=this->currCells.data()+y*width;
+    uint64_t* out=this->newCells.data()+y*width;
+    for (int x=0; x<width; x++){
+      uint64_t bit0, bit1, bit2, bit3;
+      sum_neighbours(at(up, x-1), at(up, x), at(up, x+1), at(mid, x-1), at(mid, x+1),
+                     at(down, x-1), at(down, x), at(down, x+1), bit0, bit1, bit2, bit3);
+      out[x]=transition.next_bits(mid[x], bit0, bit1, bit2, bit3);
+    }
+  }
+  std::swap(this->currCells, this->newCells);
+}
+
+void BitSlice::step(){
+  this->step(false);
+}
+
+/**
+ * BitSlice::advance(steps, toroidal)
+ *
+ * Advance all 64 worlds multiple steps.
+ * Implemented by invoking BitSlice::step(toroidal).
+ *
+ * @param steps
+ *      The number of steps to advance the worlds forward.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider every world as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ */
+
+void BitSlice::advance(int steps, bool toroidal){
+  for (int i=0; i<steps; i++){
+    this->step(toroidal);
+  }
+}
+
+void BitSlice::advance(int steps){
+  this->advance(steps, false);
+}
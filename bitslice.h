@@ -0,0 +1,49 @@
+/**
+ * Declares a class representing 64 independent, equally sized worlds sliced across the bits of one word per cell.
+ * Rich documentation for the api and behaviour the BitSlice class can be found in bitslice.cpp.
+ */
+#pragma once
+#include <cstdint>
+#include <vector>
+#include "grid.h"
+#include "rule.h"
+
+/**
+ * Declare the structure of the BitSlice class for stepping 64 small worlds with one bitwise kernel.
+ *
+ * Each cell position holds one uint64_t word, and bit k of the word is that cell in world k.
+ * Every world shares the width, height and rule of the slice.
+ */
+class BitSlice {
+  private:
+    int width;
+    int height;
+    std::vector<uint64_t> currCells;
+    std::vector<uint64_t> newCells;
+    Rule rule;
+
+    void check_world(int world) const;
+    template <typename Transition> void step(bool toroidal, const Transition& transition);
+
+  public:
+    static const int WORLDS = 64;
+
+    BitSlice();
+    BitSlice(int width, int height);
+    explicit BitSlice(const std::vector<Grid>& worlds);
+    ~BitSlice();
+
+    int get_width() const;
+    int get_height() const;
+    Grid get_state(int world) const;
+    void load(int world, const Grid& state);
+    std::vector<Grid> get_states() const;
+    int get_alive_cells(int world) const;
+    std::vector<int> get_alive_cells() const;
+    Rule get_rule() const;
+    void set_rule(const Rule& rule);
+    void step(bool toroidal);
+    void step();
+    void advance(int steps, bool toroidal);
+    void advance(int steps);
+};
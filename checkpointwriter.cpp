@@ -0,0 +1,209 @@
+/**
+ * Implements a class representing a background thread writing world checkpoints out to a file.
+ *      - The simulation thread serialises a checkpoint into memory, which is quick, and hands the bytes over.
+ *      - The writer thread writes them to a temporary file next to the checkpoint and renames it into place.
+ *          - Renaming replaces the old checkpoint in one go, so a crash while writing leaves the last good one intact.
+ *          - The temporary file is flushed to disk with fsync before the rename, and the directory after it, so
+ *            a power cut cannot leave an empty or half written file behind the new name, or lose the rename.
+ *      - Only the newest checkpoint waits to be written. Submitting again before it was written replaces it.
+ *      - Closing the writer writes any checkpoint still waiting and then stops the thread.
+ */
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+#include "checkpointwriter.h"
+
+/**
+ * write_synced(path, bytes)
+ *
+ * Writes the whole of a buffer to a new or truncated file and waits for it to reach the disk.
+ *
+ * @return
+ *      True if every byte was written and synced.
+ */
+
+static bool write_synced(const std::string& path, const std::string& bytes){
+  int fd=open(path.c_str(), O_WRONLY|O_CREAT|O_TRUNC|O_CLOEXEC, 0644);
+  if (fd<0){
+    return false;
+  }
+  const char* next=bytes.data();
+  size_t left=bytes.size();
+  while (left>0){
+    ssize_t written=write(fd, next, left);
+    if (written<0 && errno==EINTR){
+      continue;
+    }
+    if (written<=0){
+      close(fd);
+      return false;
+    }
+    next+=written;
+    left-=written;
+  }
+  bool synced=(fsync(fd)==0);
+  return close(fd)==0 && synced;
+}
+
+/**
+ * sync_directory(path)
+ *
+ * Waits for the entry of a file in its directory to reach the disk, as after renaming the file.
+ *
+ * @return
+ *      True if the directory was synced.
+ */
+
+static bool sync_directory(const std::string& path){
+  std::filesystem::path directory=std::filesystem::path(path).parent_path();
+  if (directory.empty()){
+    directory=".";
+  }
+  int fd=open(directory.c_str(), O_RDONLY|O_DIRECTORY|O_CLOEXEC);
+  if (fd<0){
+    return false;
+  }
+  bool synced=(fsync(fd)==0);
+  close(fd);
+  return synced;
+}
+
+/**
+ * CheckpointWriter::CheckpointWriter(path)
+ *
+ * Construct a writer and start its thread, waiting for the first checkpoint.
+ *
+ * @example
+ *
+ *      // Checkpoint a world every million steps without waiting on the disk
+ *      CheckpointWriter writer("run.ckpt");
+ *      std::ostringstream buffer;
+ *      world.checkpoint(buffer);
+ *      writer.submit(buffer.str(), world.get_generation());
+ *
+ * @param path
+ *      The std::string path to the checkpoint file.
+ */
+
+CheckpointWriter::CheckpointWriter(std::string path):path(std::move(path)), pendingGeneration(-1),
+ hasPending(false), closed(false), written(-1){
+  this->writer=std::thread(&CheckpointWriter::run, this);
+}
+
+CheckpointWriter::~CheckpointWriter(){
+  this->close();
+}
+
+/**
+ * CheckpointWriter::submit(bytes, generation)
+ *
+ * Hand a serialised checkpoint to the writer thread, replacing any checkpoint still waiting to be written.
+ * Checkpoints submitted after the writer is closed are ignored.
+ *
+ * @param bytes
+ *      The checkpoint, as written by World::checkpoint, moved into the writer.
+ *
+ * @param generation
+ *      The generation of the world the checkpoint holds.
+ */
+
+void CheckpointWriter::submit(std::string bytes, int64_t generation){
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    if (this->closed){
+      return;
+    }
+    this->pending=std::move(bytes);
+    this->pendingGeneration=generation;
+    this->hasPending=true;
+  }
+  this->wake.notify_one();
+}
+
+/**
+ * CheckpointWriter::close()
+ *
+ * Write the checkpoint still waiting, if any, and wait for the writer thread to stop.
+ */
+
+void CheckpointWriter::close(){
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->closed=true;
+  }
+  this->wake.notify_one();
+  if (this->writer.joinable()){
+    this->writer.join();
+  }
+}
+
+/**
+ * CheckpointWriter::get_written()
+ *
+ * Gets the generation of the last checkpoint safely written to the file.
+ *
+ * @return
+ *      The generation, or -1 if no checkpoint has been written yet.
+ */
+
+int64_t CheckpointWriter::get_written(){
+  std::lock_guard<std::mutex> guard(this->lock);
+  return this->written;
+}
+
+/**
+ * CheckpointWriter::get_error()
+ *
+ * Gets why the last checkpoint could not be written. A later checkpoint written successfully clears the error.
+ *
+ * @return
+ *      The error message, or an empty string if the last write succeeded.
+ */
+
+std::string CheckpointWriter::get_error(){
+  std::lock_guard<std::mutex> guard(this->lock);
+  return this->error;
+}
+
+/**
+ * CheckpointWriter::run()
+ *
+ * Private helper function run by the writer thread, writing each checkpoint handed to it until closed.
+ */
+
+void CheckpointWriter::run(){
+  std::string temporary=this->path+".tmp";
+  std::unique_lock<std::mutex> guard(this->lock);
+  while (true){
+    this->wake.wait(guard, [&](){ return this->closed || this->hasPending; });
+    if (!this->hasPending){
+      return;
+    }
+    std::string bytes=std::move(this->pending);
+    int64_t generation=this->pendingGeneration;
+    this->hasPending=false;
+
+    //Write without holding the lock, so the simulation thread never waits on the disk
+    guard.unlock();
+    std::string failure;
+    if (!write_synced(temporary, bytes)){
+      failure="Could not write the checkpoint file "+temporary+": "+std::strerror(errno);
+    }
+    else if (std::rename(temporary.c_str(), this->path.c_str())!=0){
+      failure="Could not replace the checkpoint file "+this->path+": "+std::strerror(errno);
+    }
+    else if (!sync_directory(this->path)){
+      failure="Could not sync the directory of the checkpoint file "+this->path+": "+std::strerror(errno);
+    }
+    guard.lock();
+
+    this->error=failure;
+    if (failure.empty()){
+      this->written=generation;
+    }
+  }
+}
@@ -0,0 +1,44 @@
+/**
+ * Declares a class representing a background thread writing world checkpoints out to a file.
+ * Rich documentation for the api and behaviour the CheckpointWriter class can be found in checkpointwriter.cpp.
+ */
+#pragma once
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ * Declare the structure of the CheckpointWriter class for saving checkpoints without stalling the simulation.
+ *
+ * The simulation thread serialises the world into memory with World::checkpoint and submits the bytes.
+ * The writer thread only ever holds the newest checkpoint waiting to be written, so a slow disk skips
+ * checkpoints rather than queueing them up.
+ */
+class CheckpointWriter {
+  private:
+    std::string path;
+    std::string pending;
+    int64_t pendingGeneration;
+    bool hasPending;
+    bool closed;
+    int64_t written;
+    std::string error;
+    std::mutex lock;
+    std::condition_variable wake;
+    std::thread writer;
+
+    void run();
+
+  public:
+    explicit CheckpointWriter(std::string path);
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+    ~CheckpointWriter();
+
+    void submit(std::string bytes, int64_t generation);
+    void close();
+    int64_t get_written();
+    std::string get_error();
+};
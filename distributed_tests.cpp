@@ -0,0 +1,134 @@
+/**
+ * BDD style (Behaviour Driven Development) test cases checking DistributedWorld against Engine::NAIVE.
+ *
+ * Engine::NAIVE steps one cell at a time straight from the rules, so it is taken as the reference. Each test steps
+ * the same random soup in worker processes over both transports, with even and odd numbers of workers and in both
+ * topologies, and must match it cell for cell.
+ *
+ * Built with Catch2 against the rest of the sources, e.g.
+ *
+ *      g++ -std=c++20 -pthread distributed_tests.cpp $(ls *.cpp | grep -v -e Game_of_Life -e _tests) -o distributed_tests
+ */
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include "distributedworld.h"
+#include "grid.h"
+#include "rule.h"
+#include "transport.h"
+#include "world.h"
+
+/**
+ * soup(width, height, seed)
+ *
+ * Makes a grid of the given size with roughly a third of its cells alive, the same cells for the same seed.
+ */
+
+static Grid soup(int width, int height, unsigned seed){
+  std::mt19937 random(seed);
+  Grid grid(width, height);
+  for (int y=0; y<height; y++){
+    for (int x=0; x<width; x++){
+      if (random()%3==0){
+        grid.set(x, y, Cell::ALIVE);
+      }
+    }
+  }
+  return grid;
+}
+
+/**
+ * same_cells(a, b)
+ *
+ * Checks that two grids are the same size with every cell equal.
+ */
+
+static bool same_cells(const Grid& a, const Grid& b){
+  if (a.get_width()!=b.get_width() || a.get_height()!=b.get_height()){
+    return false;
+  }
+  for (int y=0; y<a.get_height(); y++){
+    for (int x=0; x<a.get_width(); x++){
+      if (a.get(x, y)!=b.get(x, y)){
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * make_transport(sockets, ranks, capacity)
+ *
+ * Makes a SocketTransport or a SharedMemoryTransport.
+ */
+
+static std::unique_ptr<Transport> make_transport(bool sockets, int ranks, size_t capacity){
+  if (sockets){
+    return std::make_unique<SocketTransport>(ranks, capacity);
+  }
+  return std::make_unique<SharedMemoryTransport>(ranks, capacity);
+}
+
+SCENARIO("A DistributedWorld steps random soups exactly as Engine::NAIVE does", "[distributed]"){
+  for (bool sockets : {false, true}){
+    for (int workers : {1, 2, 3, 4}){
+      for (bool toroidal : {false, true}){
+        GIVEN("A 45x23 soup on "+std::to_string(workers)+(sockets ? " workers over sockets" : " workers over shared memory")
+              +(toroidal ? " on a torus" : " with bounded edges")){
+          Grid start=soup(45, 23, 7);
+          DistributedWorld world(start, make_transport(sockets, workers, start.get_width()));
+          World expected(start, Engine::NAIVE);
+          WHEN("Both advance under Conway's rule, then under HighLife"){
+            world.advance(9, toroidal);
+            expected.advance(9, toroidal);
+            world.set_rule(Rule::parse("B36/S23"));
+            expected.set_rule(Rule::parse("B36/S23"));
+            world.advance(6, toroidal);
+            expected.advance(6, toroidal);
+            THEN("Every cell matches"){
+              REQUIRE(world.get_alive_cells()==expected.get_alive_cells());
+              REQUIRE(same_cells(world.get_state(), expected.get_state()));
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("A DistributedWorld exchanges rows larger than its socket buffers", "[distributed]"){
+  //Rows of 16 million cells are more than the kernel lets a socket buffer hold, so sends wait on their receivers
+  for (int workers : {2, 3}){
+    GIVEN("A 16000000x4 soup on "+std::to_string(workers)+" workers over sockets"){
+      Grid start=soup(16000000, 4, 11);
+      DistributedWorld world(start, std::make_unique<SocketTransport>(workers, start.get_width()));
+      World expected(start, Engine::NAIVE);
+      WHEN("Both advance on a torus"){
+        world.advance(2, true);
+        expected.advance(2, true);
+        THEN("The workers finish without deadlocking and every cell matches"){
+          REQUIRE(world.get_alive_cells()==expected.get_alive_cells());
+          REQUIRE(same_cells(world.get_state(), expected.get_state()));
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("A transport refuses messages larger than its capacity", "[distributed]"){
+  for (bool sockets : {false, true}){
+    GIVEN(std::string(sockets ? "A SocketTransport" : "A SharedMemoryTransport")+" carrying 16 bytes"){
+      std::unique_ptr<Transport> transport=make_transport(sockets, 2, 16);
+      char message[32]={0};
+      WHEN("A 32 byte message is sent"){
+        THEN("It throws instead of overrunning the channel"){
+          REQUIRE_THROWS_AS(transport->send(0, Transport::DOWN, message, sizeof(message)), std::runtime_error);
+        }
+      }
+    }
+  }
+}
@@ -0,0 +1,628 @@
+/**
+ * Implements a class representing a 2d grid world split across several worker processes.
+ *      - The rows of the world are split into one contiguous, full width strip per worker.
+ *          - Worker processes are forked when the world is constructed and stopped when it is destroyed.
+ *          - Each worker only holds its own strip, plus one halo row above and below it.
+ *
+ *      - Stepping the world steps every strip at the same time.
+ *          - Before every generation each worker sends its top and bottom rows to the workers above and below it,
+ *            over a pluggable Transport, and receives their rows into its halos.
+ *          - On a torus the first and last workers swap rows with each other, otherwise their outer halos stay dead.
+ *          - The results match World::step exactly, in both the toroidal and bounded topologies.
+ *
+ *      - The parent process talks to each worker over a Unix domain socket, sending commands and receiving
+ *        the alive counts after each advance, or the cells of the strips when the state is requested.
+ *          - Replies are taken from whichever worker is ready first, so a worker that dies is noticed even while
+ *            the workers before it are still blocked waiting for its halo rows.
+ *          - Losing contact with any worker kills every worker, since the rest may be blocked on it forever.
+ *            The world then throws on every advance, and is only good for destroying.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "distributedworld.h"
+#include "rowkernel.h"
+
+/**
+ * A Command is sent from the parent to every worker.
+ *      - ADVANCE steps the strip the given number of generations with the given rule, then replies with its alive count.
+ *      - GATHER replies with the cells of the strip, one 0 or 1 byte per cell, row after row.
+ *      - STOP ends the worker.
+ */
+struct Command {
+    enum Op : int {
+        ADVANCE,
+        GATHER,
+        STOP
+    };
+    int op;
+    int steps;
+    int toroidal;
+    int birth;
+    int survival;
+};
+
+/**
+ * write_all(fd, data, bytes)
+ *
+ * Writes the whole of a buffer to a socket.
+ *
+ * @throws
+ *      std::runtime_error if the socket is closed or fails.
+ */
+
+static void write_all(int fd, const void* data, size_t bytes){
+  const char* next=(const char*)data;
+  while (bytes>0){
+    ssize_t written=send(fd, next, bytes, MSG_NOSIGNAL);
+    if (written<0 && errno==EINTR){
+      continue;
+    }
+    if (written<=0){
+      throw std::runtime_error("Lost contact with a worker: "+std::string(std::strerror(errno)));
+    }
+    next+=written;
+    bytes-=written;
+  }
+}
+
+/**
+ * read_all(fd, data, bytes)
+ *
+ * Reads exactly the given number of bytes from a socket.
+ *
+ * @return
+ *      False if the socket was closed before any byte was read.
+ *
+ * @throws
+ *      std::runtime_error if the socket fails, or closes part way through.
+ */
+
+static bool read_all(int fd, void* data, size_t bytes){
+  char* next=(char*)data;
+  size_t total=bytes;
+  while (bytes>0){
+    ssize_t got=recv(fd, next, bytes, 0);
+    if (got<0 && errno==EINTR){
+      continue;
+    }
+    if (got==0 && bytes==total){
+      return false;
+    }
+    if (got<=0){
+      throw std::runtime_error("Lost contact with a worker: "+std::string(std::strerror(errno)));
+    }
+    next+=got;
+    bytes-=got;
+  }
+  return true;
+}
+
+/**
+ * run_worker(rank, ranks, state, first, rows, control, transport)
+ *
+ * The main loop of a worker process, stepping one strip of the world until told to stop.
+ *
+ * The strip is held as 0/1 bytes with a halo row above and below. Every generation the worker sends its first row
+ * up and receives the row from below, then sends its last row down and receives the row from above. Even ranks
+ * send before they receive and odd ranks receive before they send, so every send is met by a receive even when
+ * a channel cannot buffer a whole row. On a torus with an odd number of workers the last and first ranks are
+ * both even, but the odd rank before the last takes its row first, which frees it to receive from the first.
+ * A lone worker on a torus is its own neighbour and copies its rows into its halos directly.
+ *
+ * @param rank
+ *      The rank of the worker.
+ *
+ * @param ranks
+ *      The number of workers.
+ *
+ * @param state
+ *      The initial state of the whole world, inherited from the parent.
+ *
+ * @param first, rows
+ *      The first row of the strip and the number of rows in it.
+ *
+ * @param control
+ *      The socket to the parent.
+ *
+ * @param transport
+ *      The transport to the other workers.
+ */
+
+static void run_worker(int rank, int ranks, const Grid& state, int first, int rows, int control, Transport& transport){
+  int width=state.get_width();
+  std::vector<uint8_t> cells((size_t)(rows+2)*width, 0);
+  std::vector<uint8_t> next((size_t)(rows+2)*width, 0);
+  std::vector<uint8_t> sums(width+2, 0);
+  for (int y=0; y<rows; y++){
+    const Cell* in=state.row(first+y);
+    for (int x=0; x<width; x++){
+      cells[(size_t)(y+1)*width+x]=(in[x]==Cell::ALIVE);
+    }
+  }
+  int up=(rank+ranks-1)%ranks;
+  int down=(rank+1)%ranks;
+  Command command;
+  while (read_all(control, &command, sizeof(command)) && command.op!=Command::STOP){
+    if (command.op==Command::GATHER){
+      write_all(control, cells.data()+width, (size_t)rows*width);
+      continue;
+    }
+    bool toroidal=command.toroidal;
+    uint32_t rule=Rule(command.birth, command.survival).packed();
+    for (int s=0; s<command.steps; s++){
+      uint8_t* top=cells.data();
+      uint8_t* bottom=cells.data()+(size_t)(rows+1)*width;
+      const uint8_t* firstRow=cells.data()+width;
+      const uint8_t* lastRow=cells.data()+(size_t)rows*width;
+      bool hasUp=toroidal || rank>0;
+      bool hasDown=toroidal || rank<ranks-1;
+      if (ranks==1){
+        if (toroidal){
+          std::copy(lastRow, lastRow+width, top);
+          std::copy(firstRow, firstRow+width, bottom);
+        }
+      }
+      else{
+        auto sendUp=[&](){
+          if (hasUp){
+            transport.send(rank, Transport::UP, firstRow, width);
+          }
+        };
+        auto sendDown=[&](){
+          if (hasDown){
+            transport.send(rank, Transport::DOWN, lastRow, width);
+          }
+        };
+        auto receiveAbove=[&](){
+          if (hasUp){
+            transport.receive(up, Transport::DOWN, top, width);
+          }
+        };
+        auto receiveBelow=[&](){
+          if (hasDown){
+            transport.receive(down, Transport::UP, bottom, width);
+          }
+        };
+        //Rows go up and then down, each rank sending before receiving if even and after receiving if odd
+        if (rank%2==0){
+          sendUp();
+          receiveBelow();
+          sendDown();
+          receiveAbove();
+        }
+        else{
+          receiveBelow();
+          sendUp();
+          receiveAbove();
+          sendDown();
+        }
+      }
+      if (!hasUp){
+        std::fill(top, top+width, 0);
+      }
+      if (!hasDown){
+        std::fill(bottom, bottom+width, 0);
+      }
+      //Sum each column of three rows, then three neighbouring columns less the cell itself
+      for (int y=1; y<=rows; y++){
+        const uint8_t* above=cells.data()+(size_t)(y-1)*width;
+        const uint8_t* mid=above+width;
+        const uint8_t* below=mid+width;
+        uint8_t* out=next.data()+(size_t)y*width;
+        sum_columns(above, mid, below, sums.data()+1, 0, width);
+        sums[0]=toroidal ? sums[width] : 0;
+        sums[width+1]=toroidal ? sums[1] : 0;
+        step_columns(sums.data()+1, mid, out, 0, width, rule);
+      }
+      std::swap(cells, next);
+    }
+    int alive=0;
+    for (int i=width; i<(rows+1)*width; i++){
+      alive+=cells[i];
+    }
+    write_all(control, &alive, sizeof(alive));
+  }
+}
+
+/**
+ * DistributedWorld::DistributedWorld(initial_state, workers)
+ *
+ * Construct a world from an initial state, split across the given number of worker processes
+ * connected by a SharedMemoryTransport.
+ *
+ * @example
+ *
+ *      // Step a large soup on 8 processes
+ *      DistributedWorld world(soup, 8);
+ *      world.advance(1000, true);
+ *
+ * @param initial_state
+ *      The state of the constructed world.
+ *
+ * @param workers
+ *      The number of worker processes, from 1 to the height of the world.
+ *
+ * @throws
+ *      std::runtime_error if the number of workers is out of range or the workers cannot be started.
+ */
+
+DistributedWorld::DistributedWorld(const Grid& initial_state, int workers):width(initial_state.get_width()),
+ height(initial_state.get_height()), alive_cells(initial_state.get_alive_cells()){
+  if (workers<1){
+    throw std::runtime_error("A distributed world needs at least one worker");
+  }
+  this->transport=std::make_unique<SharedMemoryTransport>(workers, std::max(this->width, 1));
+  this->start(initial_state);
+}
+
+/**
+ * DistributedWorld::DistributedWorld(initial_state, transport)
+ *
+ * Construct a world from an initial state, split across one worker process per rank of a transport.
+ *
+ * @example
+ *
+ *      // Step a large soup on 8 processes exchanging halos over sockets
+ *      DistributedWorld world(soup, std::make_unique<SocketTransport>(8, soup.get_width()));
+ *
+ * @param initial_state
+ *      The state of the constructed world.
+ *
+ * @param transport
+ *      The transport the workers exchange halos over, with a capacity of at least the width of the world.
+ *
+ * @throws
+ *      std::runtime_error if the transport is too small, has more ranks than the world has rows,
+ *      or the workers cannot be started.
+ */
+
+DistributedWorld::DistributedWorld(const Grid& initial_state, std::unique_ptr<Transport> transport):
+ width(initial_state.get_width()), height(initial_state.get_height()),
+ alive_cells(initial_state.get_alive_cells()), transport(std::move(transport)){
+  if (this->transport==nullptr || this->transport->get_ranks()<1){
+    throw std::runtime_error("A distributed world needs at least one worker");
+  }
+  if (this->transport->get_capacity()<(size_t)this->width){
+    throw std::runtime_error("The transport cannot carry a whole row of the world");
+  }
+  this->start(initial_state);
+}
+
+DistributedWorld::~DistributedWorld(){
+  this->stop();
+}
+
+/**
+ * DistributedWorld::get_rows(rank, first)
+ *
+ * Private helper function to find the strip of rows a worker owns.
+ *
+ * @param rank
+ *      The rank of the worker.
+ *
+ * @param first
+ *      Set to the first row of the strip.
+ *
+ * @return
+ *      The number of rows in the strip.
+ */
+
+int DistributedWorld::get_rows(int rank, int& first) const{
+  int ranks=this->transport->get_ranks();
+  first=(int)(((long long)this->height*rank)/ranks);
+  return (int)(((long long)this->height*(rank+1))/ranks)-first;
+}
+
+/**
+ * DistributedWorld::start(state)
+ *
+ * Private helper function to fork one worker process per rank of the transport.
+ * Each worker inherits the initial state, copies out its own strip, and attaches to the transport as its rank.
+ *
+ * @param state
+ *      The initial state of the world.
+ *
+ * @throws
+ *      std::runtime_error if there are more workers than rows, or a worker cannot be started.
+ */
+
+void DistributedWorld::start(const Grid& state){
+  int ranks=this->transport->get_ranks();
+  if (this->width==0 || this->height==0){
+    return;
+  }
+  if (ranks>this->height){
+    throw std::runtime_error("A distributed world cannot have more workers than rows");
+  }
+  std::vector<int> childEnds;
+  for (int rank=0; rank<ranks; rank++){
+    int ends[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends)!=0){
+      for (int fd : childEnds){
+        close(fd);
+      }
+      this->stop();
+      throw std::runtime_error("Could not create a socket pair: "+std::string(std::strerror(errno)));
+    }
+    this->controls.push_back(ends[0]);
+    childEnds.push_back(ends[1]);
+  }
+  for (int rank=0; rank<ranks; rank++){
+    pid_t pid=fork();
+    if (pid<0){
+      for (int fd : childEnds){
+        close(fd);
+      }
+      this->stop();
+      throw std::runtime_error("Could not fork a worker: "+std::string(std::strerror(errno)));
+    }
+    if (pid==0){
+      //The worker only keeps its own end of its own control socket
+      for (int fd : this->controls){
+        close(fd);
+      }
+      for (int other=0; other<ranks; other++){
+        if (other!=rank){
+          close(childEnds[other]);
+        }
+      }
+      int status=0;
+      try {
+        this->transport->attach(rank);
+        int first;
+        int rows=this->get_rows(rank, first);
+        run_worker(rank, ranks, state, first, rows, childEnds[rank], *this->transport);
+      }
+      catch (const std::exception&){
+        status=1;
+      }
+      _exit(status);
+    }
+    this->workers.push_back(pid);
+  }
+  for (int fd : childEnds){
+    close(fd);
+  }
+}
+
+/**
+ * DistributedWorld::stop()
+ *
+ * Private helper function to tell every worker to stop, then wait for the worker processes to exit.
+ */
+
+void DistributedWorld::stop(){
+  Command command={Command::STOP, 0, 0, 0, 0};
+  for (int fd : this->controls){
+    send(fd, &command, sizeof(command), MSG_NOSIGNAL);
+    close(fd);
+  }
+  for (pid_t pid : this->workers){
+    while (waitpid(pid, nullptr, 0)<0 && errno==EINTR){ }
+  }
+  this->controls.clear();
+  this->workers.clear();
+}
+
+/**
+ * DistributedWorld::kill_workers()
+ *
+ * Private helper function to kill every worker process after losing contact with one of them. The workers left
+ * may be blocked forever waiting on the lost worker's halo rows, so they could never act on a command to stop.
+ * The killed processes are still reaped by DistributedWorld::stop().
+ */
+
+void DistributedWorld::kill_workers() const{
+  for (pid_t pid : this->workers){
+    kill(pid, SIGKILL);
+  }
+}
+
+/**
+ * DistributedWorld::next_reply(pending)
+ *
+ * Private helper function to wait until any worker still owing a reply has something to read on its control
+ * socket, either its reply or the end of the socket if it died.
+ *
+ * @param pending
+ *      One flag per worker, set while its reply is still to be read. The flag of the returned worker is cleared.
+ *
+ * @return
+ *      The rank of the worker to read from.
+ *
+ * @throws
+ *      std::runtime_error if waiting on the sockets fails.
+ */
+
+int DistributedWorld::next_reply(std::vector<char>& pending) const{
+  std::vector<pollfd> fds;
+  std::vector<int> ranks;
+  for (int rank=0; rank<(int)this->controls.size(); rank++){
+    if (pending[rank]){
+      fds.push_back(pollfd{this->controls[rank], POLLIN, 0});
+      ranks.push_back(rank);
+    }
+  }
+  while (poll(fds.data(), fds.size(), -1)<0){
+    if (errno!=EINTR){
+      throw std::runtime_error("Could not wait for a worker: "+std::string(std::strerror(errno)));
+    }
+  }
+  for (size_t i=0; i<fds.size(); i++){
+    if (fds[i].revents!=0){
+      pending[ranks[i]]=0;
+      return ranks[i];
+    }
+  }
+  throw std::runtime_error("Could not wait for a worker");
+}
+
+int DistributedWorld::get_width() const{
+  return this->width;
+}
+
+int DistributedWorld::get_height() const{
+  return this->height;
+}
+
+int DistributedWorld::get_total_cells() const{
+  return this->width*this->height;
+}
+
+int DistributedWorld::get_alive_cells() const{
+  return this->alive_cells;
+}
+
+int DistributedWorld::get_dead_cells() const{
+  return this->get_total_cells()-this->alive_cells;
+}
+
+/**
+ * DistributedWorld::get_workers()
+ *
+ * Gets the number of worker processes the world is split across.
+ *
+ * @return
+ *      The number of workers, 0 for an empty world.
+ */
+
+int DistributedWorld::get_workers() const{
+  return this->workers.size();
+}
+
+Rule DistributedWorld::get_rule() const{
+  return this->rule;
+}
+
+/**
+ * DistributedWorld::set_rule(rule)
+ *
+ * Change the rule the world is stepped with. The rule is sent to the workers with every advance.
+ *
+ * @param rule
+ *      The new rule.
+ */
+
+void DistributedWorld::set_rule(const Rule& rule){
+  this->rule=rule;
+}
+
+/**
+ * DistributedWorld::get_state()
+ *
+ * Gather the strips of every worker into one Grid.
+ *
+ * @return
+ *      A grid holding the current state of the world.
+ *
+ * @throws
+ *      std::runtime_error if a worker cannot be reached, after killing every worker.
+ */
+
+Grid DistributedWorld::get_state() const{
+  Grid result(this->width, this->height);
+  Command command={Command::GATHER, 0, 0, 0, 0};
+  try {
+    for (int fd : this->controls){
+      write_all(fd, &command, sizeof(command));
+    }
+    std::vector<uint8_t> strip;
+    std::vector<char> pending(this->controls.size(), 1);
+    for (size_t n=0; n<this->controls.size(); n++){
+      int rank=this->next_reply(pending);
+      int first;
+      int rows=this->get_rows(rank, first);
+      strip.resize((size_t)rows*this->width);
+      if (!read_all(this->controls[rank], strip.data(), strip.size())){
+        throw std::runtime_error("Lost contact with a worker");
+      }
+      for (int y=0; y<rows; y++){
+        Cell* out=result.row_data(first+y, BulkKey());
+        for (int x=0; x<this->width; x++){
+          out[x]=strip[(size_t)y*this->width+x] ? Cell::ALIVE : Cell::DEAD;
+        }
+      }
+    }
+  }
+  catch (const std::runtime_error&){
+    this->kill_workers();
+    throw;
+  }
+  result.set_alive_cells(this->alive_cells, BulkKey());
+  return result;
+}
+
+/**
+ * DistributedWorld::advance(steps, toroidal)
+ *
+ * Advance multiple steps in the Game of Life. Every worker advances its strip the whole way before
+ * reporting back, so the parent process only waits once.
+ *
+ * @param steps
+ *      The number of steps to advance the world forward.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *
+ * @throws
+ *      std::runtime_error if a worker cannot be reached, after killing every worker.
+ */
+
+void DistributedWorld::advance(int steps, bool toroidal){
+  if (steps<=0 || this->controls.empty()){
+    return;
+  }
+  Command command={Command::ADVANCE, steps, toroidal, this->rule.get_birth(), this->rule.get_survival()};
+  int alive=0;
+  try {
+    for (int fd : this->controls){
+      write_all(fd, &command, sizeof(command));
+    }
+    std::vector<char> pending(this->controls.size(), 1);
+    for (size_t n=0; n<this->controls.size(); n++){
+      int count;
+      if (!read_all(this->controls[this->next_reply(pending)], &count, sizeof(count))){
+        throw std::runtime_error("Lost contact with a worker");
+      }
+      alive+=count;
+    }
+  }
+  catch (const std::runtime_error&){
+    this->kill_workers();
+    throw;
+  }
+  this->alive_cells=alive;
+}
+
+void DistributedWorld::advance(int steps){
+  this->advance(steps, false);
+}
+
+/**
+ * DistributedWorld::step(toroidal)
+ *
+ * Take one step in the Game of Life across every worker.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ */
+
+void DistributedWorld::step(bool toroidal){
+  this->advance(1, toroidal);
+}
+
+void DistributedWorld::step(){
+  this->step(false);
+}
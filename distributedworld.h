@@ -0,0 +1,56 @@
+/**
+ * Declares a class representing a 2d grid world split across several worker processes.
+ * Rich documentation for the api and behaviour the DistributedWorld class can be found in distributedworld.cpp.
+ */
+#pragma once
+#include <memory>
+#include <vector>
+#include <sys/types.h>
+#include "grid.h"
+#include "rule.h"
+#include "transport.h"
+
+/**
+ * Declare the structure of the DistributedWorld class for stepping a world too large for one process.
+ *
+ * The rows of the world are split into one horizontal strip per worker process. Each worker keeps its strip
+ * between steps and swaps one cell deep halo rows with the workers above and below it through a Transport.
+ * The parent process only sends commands and collects the alive counts, or the cells when asked for the state.
+ */
+class DistributedWorld {
+  private:
+    int width;
+    int height;
+    int alive_cells;
+    Rule rule;
+    std::unique_ptr<Transport> transport;
+    std::vector<pid_t> workers;
+    std::vector<int> controls;
+
+    void start(const Grid& state);
+    void stop();
+    void kill_workers() const;
+    int next_reply(std::vector<char>& pending) const;
+    int get_rows(int rank, int& first) const;
+
+  public:
+    DistributedWorld(const Grid& initial_state, int workers);
+    DistributedWorld(const Grid& initial_state, std::unique_ptr<Transport> transport);
+    DistributedWorld(const DistributedWorld&) = delete;
+    DistributedWorld& operator=(const DistributedWorld&) = delete;
+    ~DistributedWorld();
+
+    int get_width() const;
+    int get_height() const;
+    int get_total_cells() const;
+    int get_alive_cells() const;
+    int get_dead_cells() const;
+    int get_workers() const;
+    Rule get_rule() const;
+    void set_rule(const Rule& rule);
+    Grid get_state() const;
+    void step(bool toroidal);
+    void step();
+    void advance(int steps, bool toroidal);
+    void advance(int steps);
+};
@@ -0,0 +1,274 @@
+/**
+ * BDD style (Behaviour Driven Development) test cases checking every Engine of a World against Engine::NAIVE.
+ *
+ * Engine::NAIVE steps one cell at a time straight from the rules, so it is taken as the reference. Each other
+ * engine steps the same small random soups under several rules and both topologies, and must match it cell for
+ * cell after every advance, including after the rule or the topology changes part way through a run.
+ *
+ * Built with Catch2 against the rest of the sources, e.g.
+ *
+ *      g++ -std=c++20 -pthread engine_tests.cpp $(ls *.cpp | grep -v -e Game_of_Life -e _tests) -o engine_tests
+ */
+#define CATCH_CONFIG_MAIN
+#include <catch2/catch.hpp>
+#include <random>
+#include <ranges>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "grid.h"
+#include "hashlife.h"
+#include "rule.h"
+#include "world.h"
+#include "zoo.h"
+
+/**
+ * soup(width, height, seed)
+ *
+ * Makes a grid of the given size with roughly a third of its cells alive, the same cells for the same seed.
+ */
+
+static Grid soup(int width, int height, unsigned seed){
+  std::mt19937 random(seed);
+  Grid grid(width, height);
+  for (int y=0; y<height; y++){
+    for (int x=0; x<width; x++){
+      if (random()%3==0){
+        grid.set(x, y, Cell::ALIVE);
+      }
+    }
+  }
+  return grid;
+}
+
+/**
+ * same_cells(a, b)
+ *
+ * Checks that two grids are the same size with every cell equal.
+ */
+
+static bool same_cells(const Grid& a, const Grid& b){
+  if (a.get_width()!=b.get_width() || a.get_height()!=b.get_height()){
+    return false;
+  }
+  for (int y=0; y<a.get_height(); y++){
+    for (int x=0; x<a.get_width(); x++){
+      if (a.get(x, y)!=b.get(x, y)){
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+/**
+ * engine_name(engine)
+ *
+ * Names an engine for the descriptions of the test cases.
+ */
+
+static std::string engine_name(Engine engine){
+  static const char* NAMES[]={"NAIVE", "BITWISE", "WINDOW", "PARALLEL", "HASHLIFE", "TILED", "LOOKUP", "SIMD", "TEMPORAL"};
+  return NAMES[engine];
+}
+
+static const std::vector<Engine> ENGINES={
+    Engine::BITWISE, Engine::WINDOW, Engine::PARALLEL, Engine::TILED, Engine::LOOKUP, Engine::SIMD, Engine::TEMPORAL
+};
+
+static const std::vector<std::string> RULES={"B3/S23", "B36/S23", "B2/S", "B3678/S34678", "B0/S8"};
+
+SCENARIO("Every engine steps random soups exactly as Engine::NAIVE does", "[world][engine]"){
+  //Odd sizes leave part blocks and part words, and the larger size spans several tiles
+  const int sizes[][2]={{37, 29}, {150, 133}};
+  for (const auto& size : sizes){
+    for (const std::string& rulestring : RULES){
+      for (bool toroidal : {false, true}){
+        GIVEN("A "+std::to_string(size[0])+"x"+std::to_string(size[1])+" soup under "+rulestring
+              +(toroidal ? " on a torus" : " with bounded edges")){
+          Grid start=soup(size[0], size[1], size[0]*31+size[1]);
+          Rule rule=Rule::parse(rulestring);
+          World reference(start, Engine::NAIVE);
+          reference.set_rule(rule);
+          for (Engine engine : ENGINES){
+            World world(start, engine);
+            world.set_rule(rule);
+            if (engine==Engine::PARALLEL){
+              world.set_threads(3);
+            }
+            WHEN("Engine::"+engine_name(engine)+" advances alongside it"){
+              World expected=reference;
+              //Advancing by counts that are not multiples of World::TEMPORAL_DEPTH leaves part passes
+              for (int steps : {1, 5, 11, 20}){
+                expected.advance(steps, toroidal);
+                world.advance(steps, toroidal);
+                THEN("Every cell matches after "+std::to_string(world.get_generation())+" generations"){
+                  REQUIRE(world.get_generation()==expected.get_generation());
+                  REQUIRE(world.get_alive_cells()==expected.get_alive_cells());
+                  REQUIRE(same_cells(world.get_state(), expected.get_state()));
+                }
+              }
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("Engines which cache work drop it when the rule or topology changes", "[world][engine]"){
+  GIVEN("Two blocks against opposite edges, still under Conway's rule until the edges wrap"){
+    //The blocks sit in different tiles, and neither changes, so every tile falls asleep after the first step
+    Grid start(150, 133);
+    for (int y=60; y<62; y++){
+      for (int x : {0, 1, 148, 149}){
+        start.set(x, y, Cell::ALIVE);
+      }
+    }
+    for (Engine engine : ENGINES){
+      World world(start, engine);
+      World expected(start, Engine::NAIVE);
+      world.advance(4);
+      expected.advance(4);
+      WHEN("Engine::"+engine_name(engine)+" switches to a rule giving birth with 0 neighbours"){
+        world.set_rule(Rule::parse("B0/S8"));
+        expected.set_rule(Rule::parse("B0/S8"));
+        world.advance(3);
+        expected.advance(3);
+        THEN("Every tile wakes and every table is rebuilt for the new rule"){
+          REQUIRE(world.get_alive_cells()==expected.get_alive_cells());
+          REQUIRE(same_cells(world.get_state(), expected.get_state()));
+        }
+      }
+      WHEN("Engine::"+engine_name(engine)+" switches to a torus"){
+        world.advance(7, true);
+        expected.advance(7, true);
+        THEN("The tiles along the edges wake to see the blocks join into one"){
+          REQUIRE(world.get_alive_cells()==expected.get_alive_cells());
+          REQUIRE(same_cells(world.get_state(), expected.get_state()));
+        }
+      }
+    }
+  }
+}
+
+SCENARIO("Engine::HASHLIFE steps a window of its plane as Engine::NAIVE does", "[world][hashlife]"){
+  //The plane has no edges, so the soups sit in the middle of a bounded world too large for them to reach its edge
+  for (const std::string& rulestring : RULES){
+    Rule rule=Rule::parse(rulestring);
+    if (rule.next(false, 0)){
+      continue;
+    }
+    GIVEN("A 24x24 soup in the middle of a 160x160 world under "+rulestring){
+      Grid start(160, 160);
+      start.merge(soup(24, 24, 3), 68, 68);
+      World world(start, Engine::HASHLIFE);
+      World expected(start, Engine::NAIVE);
+      world.set_rule(rule);
+      expected.set_rule(rule);
+      WHEN("Both advance 60 generations"){
+        world.advance(60);
+        expected.advance(60);
+        THEN("Every cell of the window matches"){
+          REQUIRE(world.get_alive_cells()==expected.get_alive_cells());
+          REQUIRE(same_cells(world.get_state(), expected.get_state()));
+        }
+      }
+    }
+  }
+  GIVEN("A world on Engine::HASHLIFE"){
+    World world(soup(16, 16, 5), Engine::HASHLIFE);
+    WHEN("It is stepped as a torus"){
+      THEN("It refuses with an exception instead of aborting, and stays where it was"){
+        REQUIRE_THROWS_AS(world.step(true), std::runtime_error);
+        REQUIRE(world.get_generation()==0);
+      }
+    }
+    WHEN("It is advanced by a negative number of generations"){
+      Grid before=world.get_state();
+      world.advance(-1);
+      THEN("Nothing changes, as with every other engine"){
+        REQUIRE(world.get_generation()==0);
+        REQUIRE(same_cells(world.get_state(), before));
+      }
+    }
+    WHEN("It is switched to a rule giving birth with 0 neighbours"){
+      THEN("It refuses with an exception"){
+        REQUIRE_THROWS_AS(world.set_rule(Rule::parse("B0/S8")), std::runtime_error);
+      }
+    }
+  }
+}
+
+SCENARIO("HashLife advances astronomically many generations", "[hashlife]"){
+  GIVEN("An R-pentomino on an unbounded plane"){
+    HashLife life(Zoo::r_pentomino());
+    WHEN("It is advanced far past the 1103 generations it takes to settle"){
+      for (int i=0; i<64; i++){
+        life.advance(1LL<<20);
+      }
+      THEN("It holds the 116 cells it settles into, six of them gliders flying off forever"){
+        REQUIRE(life.get_generation()==64LL<<20);
+        REQUIRE(life.get_population()==116);
+      }
+    }
+  }
+}
+
+SCENARIO("HashLife refuses to advance backwards", "[hashlife]"){
+  GIVEN("An R-pentomino on an unbounded plane"){
+    HashLife life(Zoo::r_pentomino());
+    WHEN("It is advanced by a negative number of generations"){
+      THEN("It throws, and stays where it was"){
+        REQUIRE_THROWS_AS(life.advance(-1), std::runtime_error);
+        REQUIRE(life.get_generation()==0);
+        REQUIRE(life.get_population()==5);
+      }
+    }
+  }
+}
+
+SCENARIO("HashLife keeps advancing correctly past a garbage collection", "[hashlife]"){
+  GIVEN("A 512x512 soup, busy enough to outgrow HashLife::COLLECT_NODES within a few hundred generations"){
+    Grid start=soup(512, 512, 3);
+    HashLife collected(start);
+    HashLife whole(start);
+    WHEN("One copy is advanced 128 generations at a time, collecting its store along the way"){
+      size_t before=0;
+      bool shrank=false;
+      for (int i=0; i<6; i++){
+        collected.advance(128);
+        shrank|=(collected.get_nodes()<before);
+        before=collected.get_nodes();
+      }
+      whole.advance(768);
+      THEN("It matches a copy advanced all 768 generations in one go"){
+        REQUIRE(shrank);
+        REQUIRE(collected.get_population()==whole.get_population());
+        //Nothing travels faster than one cell a generation, so every alive cell is inside this window
+        REQUIRE(same_cells(collected.to_grid(-800, -800, 2112, 2112), whole.to_grid(-800, -800, 2112, 2112)));
+      }
+    }
+  }
+}
+
+#if defined(__cpp_impl_coroutine)
+SCENARIO("World::generations only steps the world for the generations it yields", "[generations]"){
+  GIVEN("A 45x23 soup and a copy of it stepped by hand"){
+    World world(soup(45, 23, 4));
+    World reference(soup(45, 23, 4));
+    WHEN("The first 5 generations are visited with std::views::take"){
+      int visited=0;
+      for (const Grid& generation : world.generations(true) | std::views::take(5)){
+        REQUIRE(same_cells(generation, reference.get_state()));
+        reference.step(true);
+        visited++;
+      }
+      THEN("The world is left at the last generation visited, not one past it"){
+        REQUIRE(visited==5);
+        REQUIRE(world.get_generation()==4);
+      }
+    }
+  }
+}
+#endif
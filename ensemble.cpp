@@ -0,0 +1,521 @@
+/**
+ * Implements a class representing a batch of many independent, equally sized worlds.
+ *      - Every world in an ensemble has the same width, height and rule, and is stepped at the same time.
+ *      - The cells of all the worlds live in one allocation per buffer, one 0 or 1 byte per cell,
+ *        world after world, so there is no Grid or std::vector per world.
+ *      - Worlds are set from and read back as Grid objects, or cell by cell.
+ *
+ *      - Stepping an ensemble steps every world with a branch free kernel of column sums.
+ *          - The worlds are split into one contiguous batch per thread of a ThreadPool kept between steps.
+ *          - Each world is small enough to stay in cache while it is stepped.
+ *
+ *      - Advancing an ensemble returns the population curve of every world.
+ */
+#include <stdexcept>
+#include <thread>
+#include <utility>
+#include "ensemble.h"
+#include "rowkernel.h"
+
+/**
+ * Ensemble::Ensemble()
+ *
+ * Construct an empty ensemble of no worlds.
+ *
+ * @example
+ *
+ *      // Make an empty ensemble
+ *      Ensemble ensemble;
+ *
+ */
+
+Ensemble::Ensemble():count(0), width(0), height(0), cells_per_world(0){}
+
+/**
+ * Ensemble::Ensemble(count, width, height)
+ *
+ * Construct an ensemble of the desired number of worlds, all of the desired size and filled with dead cells.
+ *
+ * @example
+ *
+ *      // Make 10000 worlds of 64x64 cells
+ *      Ensemble ensemble(10000, 64, 64);
+ *
+ * @param count
+ *      The number of worlds.
+ *
+ * @param width
+ *      The width of every world.
+ *
+ * @param height
+ *      The height of every world.
+ *
+ * @throws
+ *      std::runtime_error if any argument is negative.
+ */
+
+Ensemble::Ensemble(int count, int width, int height):count(count), width(width), height(height),
+ cells_per_world(width*height){
+  if (count<0 || width<0 || height<0){
+    throw std::runtime_error("An ensemble cannot have a negative size");
+  }
+  this->currCells.assign((size_t)count*this->cells_per_world, 0);
+  this->newCells.assign((size_t)count*this->cells_per_world, 0);
+  this->alive.assign(count, 0);
+  this->deadRow.assign(width, 0);
+}
+
+Ensemble::~Ensemble(){ }
+
+/**
+ * Ensemble::get_count()
+ *
+ * Gets the number of worlds in the ensemble.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The number of worlds.
+ */
+
+int Ensemble::get_count() const{
+  return this->count;
+}
+
+/**
+ * Ensemble::get_width()
+ *
+ * Gets the width of every world in the ensemble.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The width of the worlds.
+ */
+
+int Ensemble::get_width() const{
+  return this->width;
+}
+
+/**
+ * Ensemble::get_height()
+ *
+ * Gets the height of every world in the ensemble.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The height of the worlds.
+ */
+
+int Ensemble::get_height() const{
+  return this->height;
+}
+
+/**
+ * Ensemble::check_index(index)
+ *
+ * Private helper function to check a world index is in the ensemble.
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @throws
+ *      std::runtime_error if the index is not in [0, get_count()).
+ */
+
+void Ensemble::check_index(int index) const{
+  if (index<0 || index>=this->count){
+    throw std::runtime_error("World index out of range");
+  }
+}
+
+/**
+ * Ensemble::world_data(index)
+ *
+ * Private helper function to get a pointer to the first cell of a world in the current state buffer.
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @return
+ *      The cells of the world, row after row.
+ */
+
+uint8_t* Ensemble::world_data(int index){
+  return this->currCells.data()+(size_t)index*this->cells_per_world;
+}
+
+const uint8_t* Ensemble::world_data(int index) const{
+  return this->currCells.data()+(size_t)index*this->cells_per_world;
+}
+
+/**
+ * Ensemble::get_alive_cells(index)
+ *
+ * Gets the number of alive cells in one world of the ensemble.
+ * The function should be callable from a constant context.
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @return
+ *      The number of alive cells.
+ *
+ * @throws
+ *      std::runtime_error if the index is not in [0, get_count()).
+ */
+
+int Ensemble::get_alive_cells(int index) const{
+  this->check_index(index);
+  return this->alive[index];
+}
+
+/**
+ * Ensemble::get(index, x, y)
+ *
+ * Gets one cell of one world of the ensemble.
+ * The function should be callable from a constant context.
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @param x, y
+ *      The coordinate of the cell.
+ *
+ * @return
+ *      The cell.
+ *
+ * @throws
+ *      std::runtime_error if the index or coordinate is out of range.
+ */
+
+Cell Ensemble::get(int index, int x, int y) const{
+  this->check_index(index);
+  if (x<0 || y<0 || x>=this->width || y>=this->height){
+    throw std::runtime_error("Cell coordinate out of range");
+  }
+  return this->world_data(index)[y*this->width+x] ? Cell::ALIVE : Cell::DEAD;
+}
+
+/**
+ * Ensemble::set(index, x, y, cell)
+ *
+ * Sets one cell of one world of the ensemble, keeping its alive count up to date.
+ *
+ * @example
+ *
+ *      // Seed a random soup in every world
+ *      for (int i = 0; i < ensemble.get_count(); i++) {
+ *          for (int y = 0; y < ensemble.get_height(); y++) {
+ *              for (int x = 0; x < ensemble.get_width(); x++) {
+ *                  ensemble.set(i, x, y, (rand() % 2) ? Cell::ALIVE : Cell::DEAD);
+ *              }
+ *          }
+ *      }
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @param x, y
+ *      The coordinate of the cell.
+ *
+ * @param cell
+ *      The new value of the cell.
+ *
+ * @throws
+ *      std::runtime_error if the index or coordinate is out of range.
+ */
+
+void Ensemble::set(int index, int x, int y, Cell cell){
+  this->check_index(index);
+  if (x<0 || y<0 || x>=this->width || y>=this->height){
+    throw std::runtime_error("Cell coordinate out of range");
+  }
+  uint8_t& value=this->world_data(index)[y*this->width+x];
+  uint8_t next=(cell==Cell::ALIVE);
+  this->alive[index]+=next-value;
+  value=next;
+}
+
+/**
+ * Ensemble::get_state(index)
+ *
+ * Copies one world of the ensemble out into a Grid.
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @return
+ *      A grid holding the current state of the world.
+ *
+ * @throws
+ *      std::runtime_error if the index is not in [0, get_count()).
+ */
+
+Grid Ensemble::get_state(int index) const{
+  this->check_index(index);
+  Grid result(this->width, this->height);
+  const uint8_t* cells=this->world_data(index);
+  for (int y=0; y<this->height; y++){
+    Cell* row=result.row_data(y, BulkKey());
+    for (int x=0; x<this->width; x++){
+      row[x]=cells[y*this->width+x] ? Cell::ALIVE : Cell::DEAD;
+    }
+  }
+  result.set_alive_cells(this->alive[index], BulkKey());
+  return result;
+}
+
+/**
+ * Ensemble::load(index, state)
+ *
+ * Replaces one world of the ensemble with the cells of a Grid of the same size.
+ *
+ * @example
+ *
+ *      // Start the first world from an R-pentomino
+ *      Grid grid(64, 64);
+ *      grid.merge(Zoo::r_pentomino(), 30, 30);
+ *      ensemble.load(0, grid);
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @param state
+ *      The new state of the world.
+ *
+ * @throws
+ *      std::runtime_error if the index is out of range or the grid is not the size of the worlds.
+ */
+
+void Ensemble::load(int index, const Grid& state){
+  this->check_index(index);
+  if (state.get_width()!=this->width || state.get_height()!=this->height){
+    throw std::runtime_error("Grid size does not match the ensemble");
+  }
+  uint8_t* cells=this->world_data(index);
+  int count=0;
+  for (int y=0; y<this->height; y++){
+    const Cell* row=state.row(y);
+    for (int x=0; x<this->width; x++){
+      cells[y*this->width+x]=(row[x]==Cell::ALIVE);
+      count+=(row[x]==Cell::ALIVE);
+    }
+  }
+  this->alive[index]=count;
+}
+
+/**
+ * Ensemble::get_rule()
+ *
+ * Gets the rule every world of the ensemble is stepped with.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The current rule.
+ */
+
+Rule Ensemble::get_rule() const{
+  return this->rule;
+}
+
+/**
+ * Ensemble::set_rule(rule)
+ *
+ * Change the rule every world of the ensemble is stepped with from the next step onwards.
+ *
+ * @param rule
+ *      The new rule.
+ */
+
+void Ensemble::set_rule(const Rule& rule){
+  this->rule=rule;
+}
+
+/**
+ * Ensemble::get_threads()
+ *
+ * Gets the number of threads the ensemble is stepped with.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The number of threads, or 0 if the thread pool has not been started yet.
+ */
+
+int Ensemble::get_threads() const{
+  if (this->pool==nullptr){
+    return 0;
+  }
+  return this->pool->get_threads();
+}
+
+/**
+ * Ensemble::set_threads(threads)
+ *
+ * Start the thread pool the ensemble is stepped with, using the given number of threads.
+ * The pool persists between steps, it is only restarted when the number of threads changes.
+ * If never called, the pool is started on the first step with one thread per core.
+ *
+ * @param threads
+ *      The number of threads to step the ensemble with.
+ */
+
+void Ensemble::set_threads(int threads){
+  if (threads<1){
+    threads=1;
+  }
+  if (this->pool==nullptr || this->pool->get_threads()!=threads){
+    this->pool=std::make_shared<ThreadPool>(threads);
+  }
+}
+
+/**
+ * Ensemble::step_world(index, toroidal, sums)
+ *
+ * Private helper function to compute the next state of one world into the next state buffer.
+ *
+ * Each row is computed by the two pass kernel of rowkernel.h, with no branches in either loop: the sums of each
+ * column of the rows above, on and below it, then the sums of three neighbouring column sums less the cell itself.
+ * The rule is applied by shifting the bits of Rule::packed(), so the compiler is free to vectorise both passes.
+ *
+ * @param index
+ *      The index of the world.
+ *
+ * @param toroidal
+ *      If true then the step will consider the world as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ *
+ * @param sums
+ *      Scratch space for width + 2 column sums, one column past each edge.
+ *
+ * @return
+ *      The number of alive cells in the next state of the world.
+ */
+
+int Ensemble::step_world(int index, bool toroidal, uint8_t* sums){
+  int width=this->width;
+  int height=this->height;
+  const uint8_t* in=this->world_data(index);
+  uint8_t* out=this->newCells.data()+(size_t)index*this->cells_per_world;
+  uint32_t rule=this->rule.packed();
+  int count=0;
+  for (int y=0; y<height; y++){
+    //Rows beyond a bounded edge read from a row of dead cells, so the column sums need no checks
+    const uint8_t* up=this->deadRow.data();
+    const uint8_t* down=this->deadRow.data();
+    if (y>0){
+      up=in+(y-1)*width;
+    }
+    else if (toroidal){
+      up=in+(height-1)*width;
+    }
+    if (y<height-1){
+      down=in+(y+1)*width;
+    }
+    else if (toroidal){
+      down=in;
+    }
+    const uint8_t* mid=in+y*width;
+    uint8_t* row=out+y*width;
+    //The sums start one column before the row, so the wrapped or dead column sums sit either side of it
+    sum_columns(up, mid, down, sums+1, 0, width);
+    sums[0]=toroidal ? sums[width] : 0;
+    sums[width+1]=toroidal ? sums[1] : 0;
+    count+=step_columns(sums+1, mid, row, 0, width, rule);
+  }
+  return count;
+}
+
+/**
+ * Ensemble::step(toroidal)
+ *
+ * Take one step of every world in the ensemble.
+ *
+ * The worlds are split into one contiguous batch per thread, and each thread steps its batch one world at a time.
+ * Every world only depends on its own current state, so the result is identical for any number of threads.
+ * Then the current and next state buffers are swapped.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider each world as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ */
+
+void Ensemble::step(bool toroidal){
+  if (this->width==0 || this->height==0){
+    return;
+  }
+  if (this->pool==nullptr){
+    this->set_threads(std::thread::hardware_concurrency());
+  }
+  int batches=this->pool->get_threads();
+  if (batches>this->count){
+    batches=this->count;
+  }
+  this->columnSums.resize((size_t)batches*(this->width+2));
+  struct Batches {
+      Ensemble* ensemble;
+      int batches;
+      bool toroidal;
+  } job={this, batches, toroidal};
+  this->pool->run(batches, [](void* context, int batch){
+    Batches& job=*(Batches*)context;
+    Ensemble* ensemble=job.ensemble;
+    int first=((long long)ensemble->count*batch)/job.batches;
+    int last=((long long)ensemble->count*(batch+1))/job.batches;
+    uint8_t* sums=ensemble->columnSums.data()+batch*(ensemble->width+2);
+    for (int index=first; index<last; index++){
+      ensemble->alive[index]=ensemble->step_world(index, job.toroidal, sums);
+    }
+  }, &job);
+  std::swap(this->currCells, this->newCells);
+}
+
+void Ensemble::step(){
+  this->step(false);
+}
+
+/**
+ * Ensemble::advance(steps, toroidal)
+ *
+ * Advance every world in the ensemble multiple steps, recording the population of every world at every generation.
+ * Implemented by invoking Ensemble::step(toroidal).
+ *
+ * @example
+ *
+ *      // Run 1000 soups for 500 generations
+ *      Ensemble ensemble(1000, 64, 64);
+ *      ...
+ *      std::vector<int> curves = ensemble.advance(500, true);
+ *
+ *      // The population of world 7 after 100 steps
+ *      int population = curves[7 * 501 + 100];
+ *
+ * @param steps
+ *      The number of steps to advance the worlds forward.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider each world as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *
+ * @return
+ *      The population curves of every world, world after world, each of steps + 1 counts starting
+ *      from the population before the first step. The count of world i after g steps is at i * (steps + 1) + g.
+ */
+
+std::vector<int> Ensemble::advance(int steps, bool toroidal){
+  if (steps<0){
+    steps=0;
+  }
+  std::vector<int> curves((size_t)this->count*(steps+1));
+  for (int g=0; g<=steps; g++){
+    if (g>0){
+      this->step(toroidal);
+    }
+    for (int index=0; index<this->count; index++){
+      curves[(size_t)index*(steps+1)+g]=this->alive[index];
+    }
+  }
+  return curves;
+}
+
+std::vector<int> Ensemble::advance(int steps){
+  return this->advance(steps, false);
+}
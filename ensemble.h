@@ -0,0 +1,59 @@
+/**
+ * Declares a class representing a batch of many independent, equally sized worlds.
+ * Rich documentation for the api and behaviour the Ensemble class can be found in ensemble.cpp.
+ */
+#pragma once
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "grid.h"
+#include "rule.h"
+#include "threadpool.h"
+
+/**
+ * Declare the structure of the Ensemble class for stepping thousands of small worlds side by side.
+ *
+ * The cells of every world are stored one byte each, 0 or 1, back to back in a single buffer for the current
+ * state and a single buffer for the next state. Beyond its cells, each world only costs its alive count.
+ */
+class Ensemble {
+  private:
+    int count;
+    int width;
+    int height;
+    int cells_per_world;
+    std::vector<uint8_t> currCells;
+    std::vector<uint8_t> newCells;
+    std::vector<int> alive;
+    std::vector<uint8_t> deadRow;
+    std::vector<uint8_t> columnSums;
+    Rule rule;
+    std::shared_ptr<ThreadPool> pool;
+
+    uint8_t* world_data(int index);
+    const uint8_t* world_data(int index) const;
+    void check_index(int index) const;
+    int step_world(int index, bool toroidal, uint8_t* sums);
+
+  public:
+    Ensemble();
+    Ensemble(int count, int width, int height);
+    ~Ensemble();
+
+    int get_count() const;
+    int get_width() const;
+    int get_height() const;
+    int get_alive_cells(int index) const;
+    Cell get(int index, int x, int y) const;
+    void set(int index, int x, int y, Cell cell);
+    Grid get_state(int index) const;
+    void load(int index, const Grid& state);
+    Rule get_rule() const;
+    void set_rule(const Rule& rule);
+    int get_threads() const;
+    void set_threads(int threads);
+    void step(bool toroidal);
+    void step();
+    std::vector<int> advance(int steps, bool toroidal);
+    std::vector<int> advance(int steps);
+};
@@ -0,0 +1,149 @@
+/**
+ * Declares a minimal coroutine generator, a lazily computed input range of the values a coroutine yields.
+ *      - Stands in for C++23 std::generator, and only needs C++20 coroutines.
+ *      - A Generator is a move only view, so it composes with std::views such as std::views::take.
+ *      - Values are yielded by reference and never copied, the reference lasting until the coroutine is resumed.
+ *      - The coroutine only runs on to its next value once that value is read or compared, not when incremented.
+ */
+#pragma once
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <iterator>
+#include <memory>
+#include <ranges>
+#include <type_traits>
+#include <utility>
+
+/**
+ * Declare the structure of the Generator class template for a coroutine yielding references of type T.
+ *
+ * @example
+ *
+ *      // Yield the numbers held by a vector without copying them
+ *      Generator<const int&> each(const std::vector<int>& values) {
+ *          for (const int& value : values) {
+ *              co_yield value;
+ *          }
+ *      }
+ */
+template <typename T>
+class Generator : public std::ranges::view_base {
+    static_assert(std::is_reference_v<T>, "A Generator yields references to values owned by the coroutine");
+
+  public:
+    using value_type = std::remove_cvref_t<T>;
+
+    struct promise_type {
+        std::add_pointer_t<T> current = nullptr;
+        std::exception_ptr exception;
+
+        Generator get_return_object(){
+          return Generator(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        std::suspend_always initial_suspend() noexcept{
+          return {};
+        }
+        std::suspend_always final_suspend() noexcept{
+          return {};
+        }
+        std::suspend_always yield_value(T value) noexcept{
+          this->current=std::addressof(value);
+          return {};
+        }
+        void return_void(){ }
+        void unhandled_exception(){
+          this->exception=std::current_exception();
+        }
+    };
+
+    /**
+     * An iterator resumes the coroutine when it is next read or compared after being incremented, rather than when
+     * incremented, so a consumer that stops after its last increment, as std::views::take does, never runs the
+     * coroutine on to a value it will not read.
+     */
+    class iterator {
+      private:
+        std::coroutine_handle<promise_type> handle;
+        mutable bool pending = false;
+
+        void resume() const{
+          if (this->pending){
+            this->pending=false;
+            this->handle.resume();
+            if (this->handle.promise().exception){
+              std::rethrow_exception(this->handle.promise().exception);
+            }
+          }
+        }
+
+      public:
+        using value_type = Generator::value_type;
+        using difference_type = std::ptrdiff_t;
+
+        iterator() = default;
+        explicit iterator(std::coroutine_handle<promise_type> handle):handle(handle){ }
+
+        T operator*() const{
+          this->resume();
+          return static_cast<T>(*this->handle.promise().current);
+        }
+        iterator& operator++(){
+          //A second increment without a read in between still skips the value yielded in between
+          this->resume();
+          this->pending=true;
+          return *this;
+        }
+        void operator++(int){
+          ++*this;
+        }
+        bool operator==(std::default_sentinel_t) const{
+          if (!this->handle){
+            return true;
+          }
+          this->resume();
+          return this->handle.done();
+        }
+    };
+
+    Generator() = default;
+    Generator(const Generator&) = delete;
+    Generator& operator=(const Generator&) = delete;
+    Generator(Generator&& other) noexcept:handle(std::exchange(other.handle, nullptr)){ }
+    Generator& operator=(Generator&& other) noexcept{
+      if (this!=&other){
+        if (this->handle){
+          this->handle.destroy();
+        }
+        this->handle=std::exchange(other.handle, nullptr);
+      }
+      return *this;
+    }
+    ~Generator(){
+      if (this->handle){
+        this->handle.destroy();
+      }
+    }
+
+    /**
+     * Generator::begin()
+     *
+     * Run the coroutine up to its first yield. A generator can only be iterated once.
+     */
+    iterator begin(){
+      this->handle.resume();
+      if (this->handle.promise().exception){
+        std::rethrow_exception(this->handle.promise().exception);
+      }
+      return iterator(this->handle);
+    }
+
+    std::default_sentinel_t end() const{
+      return std::default_sentinel;
+    }
+
+  private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Generator(std::coroutine_handle<promise_type> handle):handle(handle){ }
+};
@@ -6,6 +6,21 @@
  *      - Grids can return counts of the alive and dead cells.
  *      - Grids can be serialized directly to an ascii std::ostream.
  *
+ *      - Copies of a grid share its cells until one of them writes, which then takes a copy of its own.
+ *          - Snapshots handed to savers, printers and other threads cost O(1) until the grid is next written.
+ *          - Every write goes through Grid::set, Grid::operator()(x, y), Grid::merge or Grid::row_data,
+ *            which all copy the cells first while they are shared.
+ *          - Grid::operator()(x, y) hands out a reference the grid cannot see writes through, so once it has been
+ *            called the cells are never shared again, and copies of the grid take cells of their own straight away.
+ *
+ *      - The cells are allocated from a std::pmr::memory_resource, by default std::pmr::get_default_resource().
+ *          - resources.h declares resources for cache line aligned cells, huge pages, and an arena for
+ *            short lived crops and rotations.
+ *
+ *      - A GridView reads a rectangle of cells held by a Grid or a World without copying them.
+ *          - Views are a pointer, a size and a stride, so cropping a view is free.
+ *          - Merging, printing and saving all read through a view, so a Grid is never copied to be read.
+ *
  * You are encouraged to use STL container types as an underlying storage mechanism for the grid cells.
  *
  * @author 963356
@@ -19,6 +34,8 @@
 #include <sstream>
 #include <string>
 #include <iostream>
+#include <algorithm>
+#include <utility>
 #include "grid.h"
 /**
  * Grid::Grid()
@@ -33,7 +50,8 @@
  *
  */
 
- Grid::Grid():width(0), height(0), total_cells(0), dead_cells(0), alive_cells(0){
+ Grid::Grid():width(0), height(0), total_cells(0), dead_cells(0), alive_cells(0), stale(false),
+ resource(std::pmr::get_default_resource()), unshareable(false){
 
  }
 
@@ -62,14 +80,9 @@
  */
 
  Grid::Grid(int square_size) : width(square_size), height(square_size),
- total_cells(square_size*square_size), dead_cells(square_size*square_size), alive_cells(0){
-   int tcells=square_size*square_size;
-   std::vector<Cell> cList;
-   cList.resize(tcells);
-   for (int i=0; i<tcells; i++){
-     cList.at(i)=Cell::DEAD;
-   }
-   this->cellList=cList;
+ total_cells(square_size*square_size), dead_cells(square_size*square_size), alive_cells(0), stale(false),
+ resource(std::pmr::get_default_resource()), unshareable(false){
+   this->cellList=std::make_shared<CellList>(this->total_cells, Cell::DEAD, this->resource);
  }
 
 /**
@@ -88,15 +101,39 @@
  * @param height
  *      The height of the grid.
  */
- Grid::Grid(int width, int height) : width(width), height(height),
- total_cells(width*height), dead_cells(width*height), alive_cells(0){
-   int tcells=width*height;
-   std::vector<Cell> cList;
-   cList.resize(tcells);
-   for (int i=0; i<tcells; i++){
-     cList.at(i)=Cell::DEAD;
-   }
-   this->cellList=cList;
+ Grid::Grid(int width, int height) : Grid(width, height, std::pmr::get_default_resource()){ }
+
+/**
+ * Grid::Grid(width, height, resource)
+ *
+ * Construct a grid with the desired size filled with dead cells, allocated from a memory resource.
+ * Copies of the grid share its cells, and any copy made when one of them writes, or when the grid is resized,
+ * is allocated from the same resource. The resource must outlive the grid and every copy of it.
+ * Grids made without a resource use std::pmr::get_default_resource(), so std::pmr::set_default_resource
+ * moves every grid of a program onto another resource at once.
+ *
+ * @example
+ *
+ *      // Make a grid of 2^32 cells on huge pages, so stepping it misses the TLB less often
+ *      Grid grid(65536, 65536, huge_page_resource());
+ *
+ *      // Make a grid whose rows of 1024 cells each start on a cache line
+ *      Grid aligned(1024, 1024, aligned_resource());
+ *
+ * @param width
+ *      The width of the grid.
+ *
+ * @param height
+ *      The height of the grid.
+ *
+ * @param resource
+ *      The memory resource to allocate the cells from, such as those declared in resources.h.
+ */
+
+ Grid::Grid(int width, int height, std::pmr::memory_resource* resource) : width(width), height(height),
+ total_cells(width*height), dead_cells(width*height), alive_cells(0), stale(false), resource(resource),
+ unshareable(false){
+   this->cellList=std::make_shared<CellList>(this->total_cells, Cell::DEAD, this->resource);
  }
 
 /**
@@ -187,6 +224,8 @@ int Grid::get_width() const{
  * Grid::get_alive_cells()
  *
  * Counts how many cells in the grid are alive.
+ * The count is kept up to date by every write, so this is O(1). The only exception is after a cell was handed out
+ * by Grid::operator()(x, y) for writing, when the cells are counted once here and the count is up to date again.
  * The function should be callable from a constant context.
  *
  * @example
@@ -208,6 +247,9 @@ int Grid::get_width() const{
  */
 
  int Grid::get_alive_cells() const{
+   if (this->stale){
+     this->recount();
+   }
    return this->alive_cells;
  }
 
@@ -236,9 +278,31 @@ int Grid::get_width() const{
  */
 
  int Grid::get_dead_cells() const{
+   if (this->stale){
+     this->recount();
+   }
    return this->dead_cells;
  }
 
+/**
+ * Grid::get_resource()
+ *
+ * Gets the memory resource the cells of the grid are allocated from.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Make a grid the same size as another, on the same resource
+ *      Grid next(grid.get_width(), grid.get_height(), grid.get_resource());
+ *
+ * @return
+ *      The memory resource.
+ */
+
+std::pmr::memory_resource* Grid::get_resource() const{
+  return this->resource;
+}
+
 /**
  * Grid::resize(square_size)
  *
@@ -261,7 +325,7 @@ void Grid::resize(int square_size){
   int oldWidth=this->get_width();
   int oldHeight=this->get_height();
 
-  std::vector<Cell> newList;
+  CellList newList(this->resource);
   int newLength=square_size*square_size;
   newList.resize(newLength);
   for (int i=0; i<newLength; i++){
@@ -318,7 +382,9 @@ void Grid::resize(int square_size){
   this->dead_cells=(height*width)-alive;
   this->alive_cells=alive;
   this->total_cells=height*width;
-  this->cellList=newList;
+  this->cellList=std::make_shared<CellList>(std::move(newList));
+  this->stale=false;
+  this->unshareable=false;
 }
 
 /**
@@ -345,7 +411,7 @@ void Grid::resize(int square_size){
 void Grid::resize(int width, int height){
    int oldWidth=this->get_width();
    int oldHeight=this->get_height();
-   std::vector<Cell> newList;
+   CellList newList(this->resource);
    int newLength=width*height;
    newList.resize(newLength);
    for (int i=0; i<newLength; i++){
@@ -405,7 +471,9 @@ void Grid::resize(int width, int height){
    this->dead_cells=(height*width)-alive;
    this->alive_cells=alive;
    this->total_cells=height*width;
-   this->cellList=newList;
+   this->cellList=std::make_shared<CellList>(std::move(newList));
+   this->stale=false;
+   this->unshareable=false;
 }
 /**
  * Grid::get_index(x, y)
@@ -460,24 +528,17 @@ void Grid::resize(int width, int height){
  */
 
  Cell Grid::get(int x, int y) const{
-   Cell n;
-   int w=this->width;
-   int index=(y*w)+x;
-   int height=this->get_height();
-   int width=this->get_width();
-   if (x>width || y>height || x<0 || y<0){
+   if (x>=this->width || y>=this->height || x<0 || y<0){
      throw "NOPE";
    }
-   n=(this->cellList).at(index);
-   return n;
+   return this->cell_data()[y*this->width+x];
  }
 
 /**
  * Grid::set(x, y, value)
  *
  * Overwrites the value at the desired coordinate.
- * The function should be callable from a constant context.
- * Should be implemented by invoking Grid::operator()(x, y).
+ * The cell is written in place and the alive and dead counts are adjusted by the difference, so this is O(1).
  *
  * @example
  *
@@ -500,37 +561,16 @@ void Grid::resize(int width, int height){
  *      std::exception or sub-class if x,y is not a valid coordinate within the grid.
  */
  void Grid::set(int x, int y, Cell c){
-   int w=this->get_width();
-   int index=(y*w)+x;
-   std::vector<Cell> l=this->cellList;
-   int currAlive=this->get_alive_cells();
-   int currDead=this->get_dead_cells();
-   int height=this->get_height();
-   int width=this->get_width();
-   if (x>width || y>height || x<0 || y<0){
+   if (x>=this->width || y>=this->height || x<0 || y<0){
      throw "Setting out of bounds";
    }
-   //Getting the current state of the cell
-
-   if (c==Cell::ALIVE){
-     currAlive++;
-     if (currDead>0){
-       currDead--;
-     }
-     l.at(index)=Cell::ALIVE;
-   }
-   else if (c==Cell::DEAD){
-     if (currAlive>0){
-       currAlive--;
-     }
-     currDead++;
-     l.at(index)=Cell::DEAD;
+   //Write the cell in place, adjusting the counts by the difference it makes
+   Cell& cell=this->row_data(y, BulkKey())[x];
+   if (!this->stale){
+     this->alive_cells+=(c==Cell::ALIVE)-(cell==Cell::ALIVE);
+     this->dead_cells=this->total_cells-this->alive_cells;
    }
-
-   //Finally, replace the cellList with the new cellList
-   this->cellList=l;
-   this->alive_cells=currAlive;
-   this->dead_cells=currDead;
+   cell=c;
  }
 
 
@@ -539,6 +579,12 @@ void Grid::resize(int width, int height){
  *
  * Gets a modifiable reference to the value at the desired coordinate.
  * Should be implemented by invoking Grid::get_index(x, y).
+ * What is written through the reference cannot be seen, so the alive and dead counts are recounted the next time
+ * they are asked for. Grid::set(x, y, value) keeps them up to date instead, and should be preferred for bulk writes
+ * which are interleaved with reading the counts.
+ * Once a reference has been handed out the grid stops sharing its cells, so copying the grid copies the cells
+ * straight away and writes through the reference are never seen by a copy. The reference is valid until the grid
+ * is resized, moved from, or assigned to.
  *
  * @example
  *
@@ -571,27 +617,14 @@ void Grid::resize(int width, int height){
  */
 
 Cell& Grid::operator()(int x, int y){
-  int index=this->get_index(x, y);
-  //Feels cheaty...
-  int dead=this->get_dead_cells();
-  int alive=this->get_alive_cells();
-  int height=this->get_height();
-  int width=this->get_width();
-  if (x>width || y>height || x<0 || y<0){
+  if (x>=this->width || y>=this->height || x<0 || y<0){
     throw "NOPE";
   }
-  if (this->get(x,y)==Cell::ALIVE){
-    alive--;
-    dead++;
-  }
-  else{
-    alive++;
-    dead--;
-  }
-  this->dead_cells=dead;
-  this->alive_cells=alive;
-  Cell& c=(this->cellList).at(index);
-  return c;
+  //The caller may write anything through the reference, so count the cells again when next asked
+  this->stale=true;
+  Cell* row=this->row_data(y, BulkKey());
+  this->unshareable=true;
+  return row[x];
 }
 
 /**
@@ -626,21 +659,15 @@ Cell& Grid::operator()(int x, int y){
  */
 
 Cell Grid::operator()(int x, int y) const{
-   Cell result;
-   result=this->get(x, y);
-   int height=this->get_height();
-   int width=this->get_width();
-   if (x>width || y>height || x<0 || y<0){
-     throw "NOPE";
-   }
-   return result;
+  return this->get(x, y);
 }
 
 /**
  * Grid::crop(x0, y0, x1, y1)
  *
- * Extract a sub-grid from a Grid.
- * The cropped grid spans the range [x0, x1) by [y0, y1) in the original grid.
+ * Gets a read-only view of a sub-grid of a Grid, without copying it.
+ * The cropped view spans the range [x0, x1) by [y0, y1) in the original grid, and is valid until the grid is
+ * destroyed, resized or written. Pass it to Grid::Grid(view) to copy the cells into a grid of their own.
  * The function should be callable from a constant context.
  *
  * @example
@@ -648,8 +675,12 @@ Cell Grid::operator()(int x, int y) const{
  *      // Make a grid
  *      Grid y(4, 4);
  *
- *      // Crop the centre 2x2 in y, trimming a 1 cell border off all sides
- *      Grid x = y.crop(x, 1, 1, 3, 3);
+ *      // Look at the centre 2x2 in y, trimming a 1 cell border off all sides
+ *      GridView x = y.crop(1, 1, 3, 3);
+ *
+ *      // Copy the centre into a grid of its own, or into an arena
+ *      Grid z(y.crop(1, 1, 3, 3));
+ *      Grid w(y.crop(1, 1, 3, 3), &arena);
  *
  * @param x0
  *      Left coordinate of the crop window on x-axis.
@@ -664,94 +695,15 @@ Cell Grid::operator()(int x, int y) const{
  *      Bottom coordinate of the crop window on y-axis (1 greater than the largest index).
  *
  * @return
- *      A new grid of the cropped size containing the values extracted from the original grid.
+ *      A view of the cropped range of the grid.
  *
  * @throws
  *      std::exception or sub-class if x0,y0 or x1,y1 are not valid coordinates within the grid
  *      or if the crop window has a negative size.
  */
 
-Grid Grid::crop(int x0, int y0, int x1, int y1){
-  //std::vector<Cell> currList=this->cellList;
-  int currHeight=this->get_height();
-  int currWidth=this->get_width();
-
-  //Exception handling
-  if (x1>currWidth || y1>currHeight || x0>x1 || y0>y1 || x0<0 || y0<0){
-    throw "Crop range outside of acceptable range";
-  }
-
-  int height;
-  int width;
-  if (x0<x1){
-    width=x1-x0;
-  }
-  else{
-    width=x0-x1;
-  }
-  if (y0<y1){
-    height=x1-x0;
-  }
-  else{
-    height=y0-y1;
-  }
-  Grid g(width, height);
-  int xcor=0;
-  int ycor=0;
-  //Making sure we move in the correct y direction
-  if (y0<y1){
-    for (int i=y0; i<y1; i++){
-      if (x0<x1){
-        for (int j=x0; j<x1; j++){
-          Cell cell=this->get(j, i);
-          if (cell==Cell::ALIVE){
-            g.set(xcor, ycor, Cell::ALIVE);
-          }
-          xcor++;
-        }
-        xcor=0;
-        ycor++;
-      }
-      else{
-        for (int j=x1; j<x0; j++){
-          Cell cell=this->get(j, i);
-          if (cell==Cell::ALIVE){
-            g.set(xcor, ycor, Cell::ALIVE);
-          }
-          xcor++;
-        }
-        xcor=0;
-        ycor++;
-      }
-    }
-  }
-  else{
-    for (int i=y1; i<y0; i++){
-      if (x0<x1){
-        for (int j=x0; j<x1; j++){
-          Cell cell=this->get(j, i);
-          if (cell==Cell::ALIVE){
-            g.set(xcor, ycor, Cell::ALIVE);
-          }
-          xcor++;
-        }
-        xcor=0;
-        ycor++;
-      }
-      else{
-        for (int j=x1; j<x0; j++){
-          Cell cell=this->get(j, i);
-          if (cell==Cell::ALIVE){
-            g.set(xcor, ycor, Cell::ALIVE);
-          }
-          xcor++;
-        }
-        xcor=0;
-        ycor++;
-      }
-    }
-  }
-  return g;
+GridView Grid::crop(int x0, int y0, int x1, int y1) const{
+  return this->view().crop(x0, y0, x1, y1);
 }
 
 /**
@@ -759,6 +711,7 @@ Grid Grid::crop(int x0, int y0, int x1, int y1){
  *
  * Merge two grids together by overlaying the other on the current grid at the desired location.
  * By default merging overwrites all cells within the merge reason to be the value from the other grid.
+ * The other grid is read through a GridView, so a Grid, or any view of a Grid or World, is merged without a copy.
  *
  * Conditionally if alive_only = true perform the merge such that only alive cells are updated.
  *      - If a cell is originally dead it can be updated to be alive from the merge.
@@ -776,7 +729,7 @@ Grid Grid::crop(int x0, int y0, int x1, int y1){
  *      y.merge(x, 2, 2, true);
  *
  * @param other
- *      The other grid to merge into the current grid.
+ *      The other grid, or a view of one, to merge into the current grid.
  *
  * @param x0
  *      The x coordinate of where to place the top left corner of the other grid.
@@ -792,92 +745,40 @@ Grid Grid::crop(int x0, int y0, int x1, int y1){
  *      std::exception or sub-class if the other grid being placed does not fit within the bounds of the current grid.
  */
 
-void Grid::merge(Grid other, int x0, int y0){
-  std::vector<Cell> otherCellList=other.cellList;
-  std::vector<Cell> myCellList=this->cellList;
-  int totalDead=this->get_dead_cells();
-  int totalAlive=this->get_alive_cells();
-  int otherHeight=other.get_height();
-  int otherWidth=other.get_width();
-  int myHeight=this->get_height();
-  int myWidth=this->get_width();
-  int index=0;
-  int myIndex;
-  if (x0<0 || y0<0 || x0+otherWidth>myWidth || y0+otherHeight>myHeight){
-    throw "NOPE";
-  }
-  for (int i=y0; i<otherHeight+y0; i++){
-    for (int j=x0; j<otherWidth+x0; j++){
-      myIndex=this->get_index(j, i);
-
-      Cell c=otherCellList.at(index);
-      //Increasing the dead count if required
-      if (c==Cell::DEAD && myCellList.at(myIndex)==Cell::ALIVE){
-        totalDead++;
-        totalAlive--;
-      }
-      else if (c==Cell::ALIVE && myCellList.at(myIndex)==Cell::DEAD){
-        totalDead--;
-        totalAlive++;
-      }
-      myCellList.at(myIndex)=c;
-      index++;
-    }
-  }
-
-  this->cellList=myCellList;
-  this->alive_cells=totalAlive;
-  this->dead_cells=totalDead;
-
+void Grid::merge(const GridView& other, int x0, int y0){
+  this->merge(other, x0, y0, false);
 }
 
-void Grid::merge(Grid other, int x0, int y0, bool alive_only){
-  std::vector<Cell> otherCellList=other.cellList;
-  std::vector<Cell> myCellList=this->cellList;
-  int totalDead=this->get_dead_cells();
-  int totalAlive=this->get_alive_cells();
+void Grid::merge(const GridView& other, int x0, int y0, bool alive_only){
   int otherHeight=other.get_height();
   int otherWidth=other.get_width();
-  int myHeight=this->get_height();
-  int myWidth=this->get_width();
-  int index=0;
-  int myIndex;
-  if (x0<0 || y0<0 || x0+otherWidth>myWidth || y0+otherHeight>myHeight){
+  if (x0<0 || y0<0 || x0+otherWidth>this->get_width() || y0+otherHeight>this->get_height()){
     throw "NOPE";
   }
-  for (int i=y0; i<otherHeight+y0; i++){
-    for (int j=x0; j<otherWidth+x0; j++){
-      myIndex=this->get_index(j, i);
-
-      Cell c=otherCellList.at(index);
-      //If alive_only is true, kill the merged cells that are alive
-      if (alive_only){
-        if (c==Cell::ALIVE && myCellList.at(myIndex)==Cell::DEAD){
-          totalDead--;
-          totalAlive++;
-          myCellList.at(myIndex)=c;
-        }
-      }
-      else{
-        if (c==Cell::DEAD && myCellList.at(myIndex)==Cell::ALIVE){
-          totalDead++;
-          totalAlive--;
-        }
-        else if (c==Cell::ALIVE && myCellList.at(myIndex)==Cell::DEAD){
-          totalDead--;
-          totalAlive++;
-        }
-        myCellList.at(myIndex)=c;
+  if (otherWidth==0 || otherHeight==0){
+    return;
+  }
+  //A view of this grid could overlap the cells being written, so merge from a copy of it instead
+  const Cell* first=other.row(0);
+  if (first>=this->cell_data() && first<this->cell_data()+this->total_cells){
+    Grid copy(other);
+    this->merge(copy.view(), x0, y0, alive_only);
+    return;
+  }
+  int alive=this->get_alive_cells();
+  for (int y=0; y<otherHeight; y++){
+    const Cell* in=other.row(y);
+    Cell* out=this->row_data(y0+y, BulkKey())+x0;
+    for (int x=0; x<otherWidth; x++){
+      //If alive_only is true, only the alive cells of the other grid are written
+      if (alive_only && in[x]!=Cell::ALIVE){
+        continue;
       }
-      //Increasing the dead count if required
-
-      index++;
+      alive+=(in[x]==Cell::ALIVE)-(out[x]==Cell::ALIVE);
+      out[x]=in[x];
     }
   }
-
-  this->cellList=myCellList;
-  this->alive_cells=totalAlive;
-  this->dead_cells=totalDead;
+  this->set_alive_cells(alive, BulkKey());
 }
 
 /**
@@ -904,24 +805,41 @@ void Grid::merge(Grid other, int x0, int y0, bool alive_only){
  */
 
 Grid Grid::rotate(int rotation) const{
+  return this->rotate(rotation, this->resource);
+}
+
+/**
+ * Grid::rotate(rotation, resource)
+ *
+ * Create a copy of the grid that is rotated by a multiple of 90 degrees, allocating its cells from a memory
+ * resource such as an ArenaResource. A rotation by a multiple of 360 degrees shares the cells of this grid instead.
+ * The parameters otherwise match Grid::rotate(rotation).
+ *
+ * @example
+ *
+ *      // Rotate a grid into an arena, freed along with the arena
+ *      ArenaResource arena(1 << 16);
+ *      Grid y = x.rotate(1, &arena);
+ *
+ * @return
+ *      Returns a copy of the grid that has been rotated.
+ */
+
+Grid Grid::rotate(int rotation, std::pmr::memory_resource* resource) const{
   int newHeight;
   int newWidth;
   int oldHeight=this->height;
   int oldWidth=this->width;
   int totalAlive=this->get_alive_cells();
-  int totalDead=this->get_dead_cells();
-  std::vector<Cell> newCellList;
-  newCellList.resize(oldHeight*oldWidth);
-  int index=0;
-  //0 degrees, nothing changes
+  //0 degrees, nothing changes, so the rotated grid shares the cells of this one
   if (rotation%4==0){
-    newHeight=this->height;
-    newWidth=this->width;
-    newCellList=this->cellList;
-
+    return *this;
   }
+  CellList newCellList(resource);
+  newCellList.resize(oldHeight*oldWidth);
+  int index=0;
   //90 degrees
-  else if (rotation%4==1 || rotation%4==-3){
+  if (rotation%4==1 || rotation%4==-3){
     newHeight=this->width;
     newWidth=this->height;
     for (int i=0; i<newHeight; i++){
@@ -956,13 +874,198 @@ Grid Grid::rotate(int rotation) const{
       }
     }
   }
-  Grid result(newWidth, newHeight);
-  result.cellList=newCellList;
-  result.alive_cells=totalAlive;
-  result.dead_cells=totalDead;
+  Grid result;
+  result.resource=resource;
+  result.width=newWidth;
+  result.height=newHeight;
+  result.total_cells=newWidth*newHeight;
+  result.cellList=std::make_shared<CellList>(std::move(newCellList));
+  result.set_alive_cells(totalAlive, BulkKey());
   return result;
 }
 
+/**
+ * Grid::row(y)
+ *
+ * Gets a read-only pointer to the first cell of a row.
+ * The cells of a row are stored contiguously, so the pointer can be indexed from 0 to width-1.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Make a grid
+ *      Grid grid(4, 4);
+ *
+ *      // Read the cell at coordinate (1, 2) without bounds checking
+ *      Cell cell = grid.row(2)[1];
+ *
+ * @param y
+ *      The y coordinate of the row.
+ *
+ * @return
+ *      A pointer to the cell at coordinate (0, y).
+ *
+ * @throws
+ *      std::exception or sub-class if y is not a valid row within the grid.
+ */
+
+const Cell* Grid::row(int y) const{
+  if (y<0 || y>=this->height){
+    throw "NOPE";
+  }
+  return this->cell_data()+(y*this->width);
+}
+
+/**
+ * Grid::get_owner()
+ *
+ * Gets a weak handle on the block of cells the grid uses, which expires once no grid uses the block any more.
+ * Lets a caller remember a block it has already seen, such as one a World has placed on NUMA nodes, without keeping
+ * it alive and without mistaking a new block allocated at the same address for it.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      A handle on the cells, empty for a grid which has been moved from.
+ */
+
+std::weak_ptr<const void> Grid::get_owner() const{
+  return this->cellList;
+}
+
+/**
+ * Grid::cell_data()
+ *
+ * Private helper function to get a read-only pointer to the first cell, or nullptr for a grid
+ * which has been moved from.
+ *
+ * @return
+ *      A pointer to the cell at coordinate (0, 0).
+ */
+
+const Cell* Grid::cell_data() const{
+  if (this->cellList==nullptr){
+    return nullptr;
+  }
+  return this->cellList->data();
+}
+
+/**
+ * Grid::row_data(y, key)
+ *
+ * Gets a modifiable pointer to the first cell of a row, for code filling whole rows at a time such as the engines of
+ * a World and the converters of the other grid types. Grid::set(x, y, value) remains the way to write single cells.
+ * If the cells are shared with a copy of the grid they are copied first, so the copy never sees the write.
+ * Writing through the pointer does not update the alive and dead counts, so callers must
+ * finish with Grid::set_alive_cells(alive, key).
+ *
+ * The pointer stays valid until the grid is next copied, as writing through it afterwards would
+ * change the copy too. Threads writing rows of one grid at once must call Grid::detach(key) beforehand.
+ *
+ * @param y
+ *      The y coordinate of the row.
+ *
+ * @param key
+ *      A BulkKey, which only the engines and converters allowed to write in bulk can make.
+ *
+ * @return
+ *      A pointer to the cell at coordinate (0, y).
+ */
+
+Cell* Grid::row_data(int y, BulkKey key){
+  this->detach(key);
+  return this->cellList->data()+(y*this->width);
+}
+
+/**
+ * Grid::detach(key)
+ *
+ * Gives the grid cells of its own before they are written through Grid::row_data(y, key).
+ * The cells are only copied while they are shared with a copy of the grid, otherwise this does nothing.
+ *
+ * @param key
+ *      A BulkKey, as for Grid::row_data(y, key).
+ */
+
+void Grid::detach(BulkKey){
+  if (this->cellList==nullptr){
+    this->cellList=std::make_shared<CellList>(this->total_cells, Cell::DEAD, this->resource);
+  }
+  else if (this->cellList.use_count()>1){
+    this->cellList=std::make_shared<CellList>(*this->cellList, this->resource);
+  }
+}
+
+/**
+ * Grid::renew(key)
+ *
+ * Gives the grid cells of its own before every one of them is overwritten through Grid::row_data(y, key).
+ * While the cells are shared they are replaced by dead cells rather than copied, as the copy would be thrown away.
+ * Callers must write every cell and finish with Grid::set_alive_cells(alive, key).
+ *
+ * @param key
+ *      A BulkKey, as for Grid::row_data(y, key).
+ */
+
+void Grid::renew(BulkKey){
+  if (this->cellList==nullptr || this->cellList.use_count()>1){
+    this->cellList=std::make_shared<CellList>(this->total_cells, Cell::DEAD, this->resource);
+  }
+}
+
+/**
+ * Grid::reallocate(key)
+ *
+ * Gives the grid a new block of cells from its resource without writing any of them, so each page of the block is
+ * placed on the NUMA node of the first thread to write it. Used by World to have the pool threads place the bands
+ * they step. Callers must write every cell through Grid::row_data(y, key) and finish with
+ * Grid::set_alive_cells(alive, key).
+ *
+ * @param key
+ *      A BulkKey, as for Grid::row_data(y, key).
+ */
+
+void Grid::reallocate(BulkKey){
+  this->cellList=std::make_shared<CellList>(this->total_cells, this->resource);
+}
+
+/**
+ * Grid::set_alive_cells(alive, key)
+ *
+ * Overwrites the alive and dead counts after a bulk write through Grid::row_data(y, key).
+ * The count is trusted, so it must be the number of alive cells actually written. It is not checked, as counting
+ * again would cost a pass over every cell on each step of the engines that call it.
+ *
+ * @param alive
+ *      The number of alive cells now in the grid.
+ *
+ * @param key
+ *      A BulkKey, as for Grid::row_data(y, key).
+ */
+
+void Grid::set_alive_cells(int alive, BulkKey){
+  this->alive_cells=alive;
+  this->dead_cells=this->total_cells-alive;
+  this->stale=false;
+}
+
+/**
+ * Grid::recount()
+ *
+ * Private helper function to count the alive and dead cells again after cells were written
+ * through a reference returned by Grid::operator()(x, y).
+ */
+
+void Grid::recount() const{
+  int alive=0;
+  const Cell* cells=this->cell_data();
+  for (int i=0; i<this->total_cells; i++){
+    alive+=(cells[i]==Cell::ALIVE);
+  }
+  this->alive_cells=alive;
+  this->dead_cells=this->total_cells-alive;
+  this->stale=false;
+}
+
 /**
  * operator<<(output_stream, grid)
  *
@@ -993,37 +1096,385 @@ Grid Grid::rotate(int rotation) const{
  *      An ascii mode output stream such as std::cout.
  *
  * @param grid
- *      A grid object containing cells to be printed.
+ *      A grid object, or a view of one, containing cells to be printed.
  *
  * @return
  *      Returns a reference to the output stream to enable operator chaining.
  */
 
 std::ostream& operator<<(std::ostream& stream, const Grid& grid){
-   int height=grid.get_height();
-   int width=grid.get_width();
-   stream<<"+";
-   for (int i=0; i<width; i++){
-     stream<<"-";
-   }
-   stream<<"+\n";
+  return stream<<grid.view();
+}
+
+/**
+ * Grid::Grid(other)
+ *
+ * Copy construct a grid. The copy shares the cells of the other grid, so it costs O(1) until either of them writes,
+ * unless Grid::operator()(x, y) has handed out a reference into the other grid's cells. The cells are then
+ * copied straight away, so nothing written through the reference can show up in the copy.
+ *
+ * @example
+ *
+ *      // Take a snapshot of a grid, sharing its cells until the grid is next written
+ *      Grid snapshot = grid;
+ *
+ * @param other
+ *      The grid to copy.
+ */
+
+Grid::Grid(const Grid& other):width(other.width), height(other.height), total_cells(other.total_cells),
+dead_cells(other.dead_cells), alive_cells(other.alive_cells), stale(other.stale), resource(other.resource),
+cellList(other.cellList), unshareable(false){
+  if (other.unshareable){
+    this->cellList=std::make_shared<CellList>(*other.cellList, this->resource);
+  }
+}
+
+/**
+ * Grid::operator=(other)
+ *
+ * Copy assign a grid, sharing or copying the cells of the other grid as Grid::Grid(other) does.
+ *
+ * @param other
+ *      The grid to copy.
+ *
+ * @return
+ *      This grid.
+ */
+
+Grid& Grid::operator=(const Grid& other){
+  if (this!=&other){
+    Grid copy(other);
+    *this=std::move(copy);
+  }
+  return *this;
+}
+
+/**
+ * Grid::Grid(other)
+ *
+ * Move construct a grid, taking the cells of the other grid without copying them.
+ * The other grid is left as an empty 0x0 grid.
+ *
+ * @example
+ *
+ *      // Move a grid into another without copying or sharing its cells
+ *      Grid moved = std::move(grid);
+ *
+ * @param other
+ *      The grid to move from.
+ */
+
+Grid::Grid(Grid&& other) noexcept:width(other.width), height(other.height), total_cells(other.total_cells),
+dead_cells(other.dead_cells), alive_cells(other.alive_cells), stale(other.stale), resource(other.resource),
+cellList(std::move(other.cellList)), unshareable(other.unshareable){
+  other.unshareable=false;
+  other.width=0;
+  other.height=0;
+  other.total_cells=0;
+  other.dead_cells=0;
+  other.alive_cells=0;
+  other.stale=false;
+}
+
+/**
+ * Grid::operator=(other)
+ *
+ * Move assign a grid, taking the cells of the other grid without copying them.
+ * The other grid is left as an empty 0x0 grid.
+ *
+ * @param other
+ *      The grid to move from.
+ *
+ * @return
+ *      A reference to this grid.
+ */
+
+Grid& Grid::operator=(Grid&& other) noexcept{
+  if (this!=&other){
+    this->width=std::exchange(other.width, 0);
+    this->height=std::exchange(other.height, 0);
+    this->total_cells=std::exchange(other.total_cells, 0);
+    this->dead_cells=std::exchange(other.dead_cells, 0);
+    this->alive_cells=std::exchange(other.alive_cells, 0);
+    this->stale=std::exchange(other.stale, false);
+    this->resource=other.resource;
+    this->cellList=std::move(other.cellList);
+    this->unshareable=std::exchange(other.unshareable, false);
+  }
+  return *this;
+}
+
+Grid::~Grid(){ }
+
+/**
+ * Grid::Grid(view)
+ *
+ * Construct a grid holding a copy of the cells of a view, copied a row at a time.
+ * Marked explicit, so copying a view into a grid of its own is never done by accident.
+ *
+ * @example
+ *
+ *      // Copy the top left 8x8 corner of a world into its own grid
+ *      Grid corner(world.view().crop(0, 0, 8, 8));
+ *
+ * @param view
+ *      The cells to copy.
+ */
+
+Grid::Grid(const GridView& view):Grid(view, std::pmr::get_default_resource()){ }
+
+/**
+ * Grid::Grid(view, resource)
+ *
+ * Construct a grid holding a copy of the cells of a view, allocated from a memory resource.
+ *
+ * @example
+ *
+ *      // Copy the top left 8x8 corner of a world into an arena
+ *      Grid corner(world.view().crop(0, 0, 8, 8), &arena);
+ *
+ * @param view
+ *      The cells to copy.
+ *
+ * @param resource
+ *      The memory resource to allocate the cells from.
+ */
+
+Grid::Grid(const GridView& view, std::pmr::memory_resource* resource):Grid(view.get_width(), view.get_height(), resource){
+  for (int y=0; y<this->height; y++){
+    std::copy(view.row(y), view.row(y)+this->width, this->row_data(y, BulkKey()));
+  }
+  this->set_alive_cells(view.get_alive_cells(), BulkKey());
+}
+
+/**
+ * Grid::view()
+ *
+ * Gets a read-only view of every cell of the grid, without copying them.
+ * The view is valid until the grid is destroyed, resized or written.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Print a grid without copying it
+ *      std::cout << grid.view() << std::endl;
+ *
+ * @return
+ *      A view of the whole grid, knowing its alive count.
+ */
+
+GridView Grid::view() const{
+  return GridView(this->cell_data(), this->width, this->height, this->width, this->get_alive_cells());
+}
+
+/**
+ * Grid::operator GridView()
+ *
+ * Lets a grid be passed wherever a GridView is expected, such as Grid::merge and Zoo::save_ascii, without a copy.
+ */
+
+Grid::operator GridView() const{
+  return this->view();
+}
+
+/**
+ * GridView::GridView()
+ *
+ * Construct an empty view of size 0x0.
+ */
+
+GridView::GridView():GridView(nullptr, 0, 0, 0, 0){ }
+
+/**
+ * GridView::GridView(cells, width, height, stride)
+ *
+ * Construct a view onto cells stored row by row, counting the alive cells only if asked for.
+ *
+ * @example
+ *
+ *      // View the cells of a buffer padded with a one cell border
+ *      GridView view(padded.data()+(width+2)+1, width, height, width+2);
+ *
+ * @param cells
+ *      The top left cell.
+ *
+ * @param width
+ *      The number of cells in each row.
+ *
+ * @param height
+ *      The number of rows.
+ *
+ * @param stride
+ *      The number of cells from the start of one row to the start of the next, at least the width.
+ */
+
+GridView::GridView(const Cell* cells, int width, int height, int stride):GridView(cells, width, height, stride, -1){ }
+
+/**
+ * GridView::GridView(cells, width, height, stride, alive_cells)
+ *
+ * Construct a view onto cells stored row by row whose alive count is already known.
+ *
+ * @param alive_cells
+ *      The number of alive cells in the view, or -1 to count them if asked for.
+ */
+
+GridView::GridView(const Cell* cells, int width, int height, int stride, int alive_cells):cells(cells), width(width),
+ height(height), stride(stride), alive_cells(alive_cells){ }
+
+int GridView::get_height() const{
+  return this->height;
+}
+
+int GridView::get_width() const{
+  return this->width;
+}
+
+int GridView::get_stride() const{
+  return this->stride;
+}
+
+int GridView::get_total_cells() const{
+  return this->width*this->height;
+}
+
+/**
+ * GridView::get_alive_cells()
+ *
+ * Counts how many cells in the view are alive.
+ * Views of a whole Grid or World already know the count, any other view counts its cells when asked.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The number of alive cells.
+ */
+
+int GridView::get_alive_cells() const{
+  if (this->alive_cells>=0){
+    return this->alive_cells;
+  }
+  int alive=0;
+  for (int y=0; y<this->height; y++){
+    const Cell* cells=this->row(y);
+    for (int x=0; x<this->width; x++){
+      alive+=(cells[x]==Cell::ALIVE);
+    }
+  }
+  return alive;
+}
+
+int GridView::get_dead_cells() const{
+  return this->get_total_cells()-this->get_alive_cells();
+}
+
+/**
+ * GridView::get(x, y)
+ *
+ * Returns the value of the cell at the desired coordinate of the view.
+ * The function should be callable from a constant context.
+ *
+ * @param x
+ *      The x coordinate of the cell.
+ *
+ * @param y
+ *      The y coordinate of the cell.
+ *
+ * @return
+ *      The value of the cell.
+ *
+ * @throws
+ *      std::exception or sub-class if x,y is not a valid coordinate within the view.
+ */
+
+Cell GridView::get(int x, int y) const{
+  if (x<0 || y<0 || x>=this->width || y>=this->height){
+    throw "Coordinate outside of the view";
+  }
+  return this->cells[(size_t)y*this->stride+x];
+}
+
+Cell GridView::operator()(int x, int y) const{
+  return this->get(x, y);
+}
+
+/**
+ * GridView::row(y)
+ *
+ * Gets a read-only pointer to the first cell of a row of the view, which can be indexed from 0 to width-1.
+ * The function should be callable from a constant context.
+ *
+ * @param y
+ *      The y coordinate of the row.
+ *
+ * @return
+ *      A pointer to the cell at coordinate (0, y) of the view.
+ *
+ * @throws
+ *      std::exception or sub-class if y is not a valid row within the view.
+ */
+
+const Cell* GridView::row(int y) const{
+  if (y<0 || y>=this->height){
+    throw "Row outside of the view";
+  }
+  return this->cells+(size_t)y*this->stride;
+}
+
+/**
+ * GridView::crop(x0, y0, x1, y1)
+ *
+ * Gets a view of the range [x0, x1) by [y0, y1) of this view, sharing its cells and stride.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Look at the centre of a huge world without copying anything
+ *      GridView centre = world.view().crop(4096, 4096, 4160, 4160);
+ *
+ * @return
+ *      The view of the range.
+ *
+ * @throws
+ *      std::exception or sub-class if the range is not within the view or has a negative size.
+ */
+
+GridView GridView::crop(int x0, int y0, int x1, int y1) const{
+  if (x0<0 || y0<0 || x0>x1 || y0>y1 || x1>this->width || y1>this->height){
+    throw "Crop range outside of acceptable range";
+  }
+  return GridView(this->cells+(size_t)y0*this->stride+x0, x1-x0, y1-y0, this->stride);
+}
+
+/**
+ * operator<<(output_stream, view)
+ *
+ * Serializes the cells of a view to an ascii output stream, exactly as a Grid holding them would be.
+ * Each row is written at once, as the cells are stored as their ascii characters.
+ *
+ * @param os
+ *      An ascii mode output stream such as std::cout.
+ *
+ * @param view
+ *      The view to print.
+ *
+ * @return
+ *      Returns a reference to the output stream to enable operator chaining.
+ */
+
+std::ostream& operator<<(std::ostream& stream, const GridView& view){
+   int height=view.get_height();
+   int width=view.get_width();
+   std::string border="+"+std::string(width, '-')+"+\n";
+   stream<<border;
    //Contents
    for (int i=0; i<height; i++){
      stream<<"|";
-     for (int j=0; j<width; j++){
-       Cell c=grid.get(j, i);
-       stream<<(char)c;
-     }
+     stream.write((const char*)view.row(i), width);
      stream<<"|\n";
    }
    //The bottom line
-   stream<<"+";
-   for (int i=0; i<width; i++){
-     stream<<"-";
-   }
-   stream<<"+\n";
+   stream<<border;
 
    return stream;
 }
-
-Grid::~Grid(){ }
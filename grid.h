@@ -10,10 +10,13 @@
  */
 #pragma once
 #include <vector>
+#include <memory>
+#include <memory_resource>
 #include <sstream>
 #include <string>
 #include <iostream>
 #include "grid.h"
+#include "resources.h"
 
 // Add the minimal number of includes you need in order to declare the class.
 // #include ...
@@ -26,6 +29,58 @@ enum Cell : char {
     ALIVE = '#'
 };
 
+/**
+ * Declare the structure of the GridView class for reading a rectangle of cells owned by something else.
+ *
+ * A GridView is a pointer to its top left cell, a width and height, and a stride from the start of one row
+ * to the start of the next. It never copies or owns the cells, so it is only valid while the Grid or World it
+ * was taken from is alive and unchanged in size.
+ */
+class GridView {
+  private:
+    const Cell* cells;
+    int width;
+    int height;
+    int stride;
+    int alive_cells;
+
+  public:
+    GridView();
+    GridView(const Cell* cells, int width, int height, int stride);
+    GridView(const Cell* cells, int width, int height, int stride, int alive_cells);
+
+    int get_height() const;
+    int get_width() const;
+    int get_stride() const;
+    int get_total_cells() const;
+    int get_alive_cells() const;
+    int get_dead_cells() const;
+    Cell get(int x, int y) const;
+    Cell operator()(int x, int y) const;
+    const Cell* row(int y) const;
+    GridView crop(int x0, int y0, int x1, int y1) const;
+};
+
+std::ostream& operator<<(std::ostream& stream, const GridView& view);
+
+/**
+ * A BulkKey unlocks the bulk writes of a Grid, which fill whole rows through Grid::row_data and set the alive count
+ * once at the end with Grid::set_alive_cells, trusting it. Only Grid and the engines and converters below can make
+ * one, so no other code can write cells without the counts following them.
+ */
+class BulkKey {
+    friend class Grid;
+    friend class BitGrid;
+    friend class BitSlice;
+    friend class DistributedWorld;
+    friend class Ensemble;
+    friend class HashLife;
+    friend class SparseWorld;
+    friend class World;
+
+    BulkKey(){ }
+};
+
 /**
  * Declare the structure of the Grid class for representing a 2d grid of cells.
  */
@@ -34,16 +89,32 @@ class Grid {
     int width;
     int height;
     int total_cells;
-    int dead_cells;
-    int alive_cells;
-    std::vector<Cell> cellList;
+    //Counted again on demand after a write through operator(), which cannot see what is written
+    mutable int dead_cells;
+    mutable int alive_cells;
+    mutable bool stale;
+    std::pmr::memory_resource* resource;
+    //Shared by copies of the grid until one of them writes, which then takes a copy of its own
+    typedef std::vector<Cell, UntouchedAllocator<Cell>> CellList;
+    std::shared_ptr<CellList> cellList;
+    //Set once a reference into the cells has been handed out, after which copies always take cells of their own
+    bool unshareable;
 
     int get_index() const;
+    const Cell* cell_data() const;
+    void recount() const;
 
   public:
     Grid(); //The default constructor
     Grid(int size); //The constructor for just one argument
     Grid(int width, int height); //The constructor for two arguments
+    Grid(int width, int height, std::pmr::memory_resource* resource); //Allocates the cells from the resource
+    explicit Grid(const GridView& view); //Copies the cells of a view into a grid of their own
+    Grid(const GridView& view, std::pmr::memory_resource* resource);
+    Grid(const Grid& other); //Copies share the cells, so they are O(1) until one of them writes
+    Grid(Grid&& other) noexcept; //Moves let std::swap exchange two grids without copying
+    Grid& operator=(const Grid& other);
+    Grid& operator=(Grid&& other) noexcept;
     ~Grid();
 
     //The member functions
@@ -52,17 +123,30 @@ class Grid {
     int get_total_cells() const;
     int get_alive_cells() const;
     int get_dead_cells() const;
+    std::pmr::memory_resource* get_resource() const;
     void resize(int x);
     void resize(int x, int y);
     int get_index(int x, int y);
     Cell get(int x, int y) const;
     Cell operator()(int x, int y) const;
     Cell& operator()(int x, int y);
-    Grid crop(int x, int y, int a, int b);
+    GridView crop(int x0, int y0, int x1, int y1) const;
     void set(int x, int y, Cell c);
-    void merge(Grid grid, int a, int b);
-    void merge(Grid x, int a, int b, bool c);
+    void merge(const GridView& other, int x0, int y0);
+    void merge(const GridView& other, int x0, int y0, bool alive_only);
     Grid rotate(int rotation) const;
+    Grid rotate(int rotation, std::pmr::memory_resource* resource) const;
+    const Cell* row(int y) const;
+    std::weak_ptr<const void> get_owner() const;
+    GridView view() const;
+    operator GridView() const;
     friend std::ostream& operator<<(std::ostream& stream, const Grid& grid);
 
+    //Bulk writes for the engines and converters filling whole rows, which set the counts once at the end
+    Cell* row_data(int y, BulkKey key);
+    void detach(BulkKey key);
+    void renew(BulkKey key);
+    void reallocate(BulkKey key);
+    void set_alive_cells(int alive, BulkKey key);
+
 };
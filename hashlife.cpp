@@ -0,0 +1,656 @@
+/**
+ * Implements a class for simulating the Game of Life with Bill Gosper's HashLife algorithm.
+ * https://www.conwaylife.com/wiki/HashLife
+ *
+ *      - The plane is stored as a quadtree of HashNode squares.
+ *          - Every square with the same contents is stored once, looked up by its four quadrants.
+ *          - Empty squares of every level are shared, so empty space costs nothing.
+ *
+ *      - Advancing a node of level k computes its centre square of level k-1 after 2^(k-2) generations.
+ *          - The result is memoised in the node, so a square that appears again is never recomputed.
+ *          - Smaller powers of two are memoised in a separate table keyed on the node and the step.
+ *
+ *      - HashLife::advance(n) splits n into powers of two, growing the root square until the pattern
+ *        cannot escape it, and skips 2^j generations at a time.
+ *
+ *      - Nodes are never freed one by one, so a long run garbage collects the node store instead.
+ *          - Before each power of two, a store holding more than its limit of nodes is replaced by a new store
+ *            holding only the nodes reachable from the root, along with the memoised results linking them.
+ *          - The limit starts at HashLife::COLLECT_NODES and doubles past what the root alone still needs,
+ *            so a large pattern is not collected again after every step.
+ *
+ *      - The plane is unbounded. Grids are copied in at the origin and windows of the plane are copied out.
+ *
+ *      - Copies of a HashLife share their canonical node store, which is not safe to grow from two threads at once.
+ *
+ *      - Any outer-totalistic Rule can be used, except rules giving birth with 0 neighbours, which would
+ *        fill the whole unbounded plane in one step.
+ */
+#include <algorithm>
+#include <functional>
+#include <stdexcept>
+#include "hashlife.h"
+
+bool HashLife::NodeKey::operator==(const NodeKey& other) const{
+  return nw==other.nw && ne==other.ne && sw==other.sw && se==other.se;
+}
+
+size_t HashLife::NodeKeyHash::operator()(const NodeKey& key) const{
+  std::hash<const HashNode*> hash;
+  size_t h=hash(key.nw);
+  h=h*1000003u^hash(key.ne);
+  h=h*1000003u^hash(key.sw);
+  h=h*1000003u^hash(key.se);
+  return h;
+}
+
+bool HashLife::StepKey::operator==(const StepKey& other) const{
+  return node==other.node && step==other.step;
+}
+
+size_t HashLife::StepKeyHash::operator()(const StepKey& key) const{
+  return std::hash<const HashNode*>()(key.node)*31u+key.step;
+}
+
+/**
+ * HashLife::HashLife()
+ *
+ * Construct an empty plane at generation 0.
+ *
+ * @example
+ *
+ *      // Make an empty plane
+ *      HashLife life;
+ *
+ */
+
+HashLife::HashLife():store(std::make_shared<NodeStore>()), origin_x(0), origin_y(0), generation(0){
+  this->store->limit=COLLECT_NODES;
+  this->store->nodes.push_back(HashNode{nullptr, nullptr, nullptr, nullptr, 0, 0, nullptr});
+  this->store->dead=&this->store->nodes.back();
+  this->store->nodes.push_back(HashNode{nullptr, nullptr, nullptr, nullptr, 0, 1, nullptr});
+  this->store->alive=&this->store->nodes.back();
+  this->store->empty.push_back(this->store->dead);
+  this->root=this->empty(3);
+}
+
+/**
+ * HashLife::HashLife(grid)
+ *
+ * Construct a plane at generation 0 holding the cells of a Grid, with the top left of the grid at (0, 0).
+ * All cells outside the grid are dead.
+ *
+ * @example
+ *
+ *      // Put an r-pentomino on a plane
+ *      HashLife life(Zoo::r_pentomino());
+ *
+ * @param grid
+ *      The cells to place on the plane.
+ */
+
+HashLife::HashLife(const Grid& grid):HashLife(){
+  int level=3;
+  while ((1LL<<level)<grid.get_width() || (1LL<<level)<grid.get_height()){
+    level++;
+  }
+  this->root=this->build(grid, 0, 0, level);
+}
+
+HashLife::~HashLife(){ }
+
+/**
+ * HashLife::leaf(alive)
+ *
+ * Private helper function to get the canonical level 0 node for a single cell.
+ *
+ * @param alive
+ *      True for the alive cell, false for the dead cell.
+ *
+ * @return
+ *      The canonical single cell node.
+ */
+
+const HashNode* HashLife::leaf(bool alive){
+  if (alive){
+    return this->store->alive;
+  }
+  return this->store->dead;
+}
+
+/**
+ * HashLife::join(nw, ne, sw, se)
+ *
+ * Private helper function to get the canonical node made from four quadrants of the same level.
+ * A new node is only created if no node with these quadrants exists yet.
+ *
+ * @param nw, ne, sw, se
+ *      The top left, top right, bottom left and bottom right quadrants.
+ *
+ * @return
+ *      The canonical node one level above the quadrants.
+ */
+
+const HashNode* HashLife::join(const HashNode* nw, const HashNode* ne, const HashNode* sw, const HashNode* se){
+  NodeKey key{nw, ne, sw, se};
+  auto found=this->store->canonical.find(key);
+  if (found!=this->store->canonical.end()){
+    return found->second;
+  }
+  long long population=nw->population+ne->population+sw->population+se->population;
+  this->store->nodes.push_back(HashNode{nw, ne, sw, se, nw->level+1, population, nullptr});
+  const HashNode* node=&this->store->nodes.back();
+  this->store->canonical.emplace(key, node);
+  return node;
+}
+
+/**
+ * HashLife::empty(level)
+ *
+ * Private helper function to get the canonical node of the given level with no alive cells.
+ *
+ * @param level
+ *      The level of the node.
+ *
+ * @return
+ *      The empty node.
+ */
+
+const HashNode* HashLife::empty(int level){
+  while ((int)this->store->empty.size()<=level){
+    const HashNode* below=this->store->empty.back();
+    this->store->empty.push_back(this->join(below, below, below, below));
+  }
+  return this->store->empty[level];
+}
+
+/**
+ * HashLife::step_leaves(node)
+ *
+ * Private helper function to advance the centre 2x2 cells of a level 2 (4x4) node by one generation
+ * by counting neighbours directly.
+ *
+ * @param node
+ *      A level 2 node.
+ *
+ * @return
+ *      The level 1 node holding the centre 2x2 cells one generation later.
+ */
+
+const HashNode* HashLife::step_leaves(const HashNode* node){
+  int cells[4][4];
+  const HashNode* quadrants[4]={node->nw, node->ne, node->sw, node->se};
+  for (int q=0; q<4; q++){
+    int qx=(q%2)*2;
+    int qy=(q/2)*2;
+    cells[qy][qx]=quadrants[q]->nw->population;
+    cells[qy][qx+1]=quadrants[q]->ne->population;
+    cells[qy+1][qx]=quadrants[q]->sw->population;
+    cells[qy+1][qx+1]=quadrants[q]->se->population;
+  }
+  const HashNode* next[4];
+  for (int i=0; i<4; i++){
+    int x=1+(i%2);
+    int y=1+(i/2);
+    int count=0;
+    for (int dy=-1; dy<=1; dy++){
+      for (int dx=-1; dx<=1; dx++){
+        count+=cells[y+dy][x+dx];
+      }
+    }
+    count-=cells[y][x];
+    next[i]=this->leaf(this->store->rule.next(cells[y][x]==1, count));
+  }
+  return this->join(next[0], next[1], next[2], next[3]);
+}
+
+/**
+ * HashLife::successor(node, step)
+ *
+ * Private helper function to advance the centre of a node.
+ *
+ * The node of level k is split into nine overlapping squares of level k-1, which are each advanced
+ * recursively into squares of level k-2. If step is k-2 these are joined into four squares of level k-1
+ * and advanced again, for 2^(k-3) + 2^(k-3) = 2^(k-2) generations in total. Otherwise the centres of the
+ * nine results are joined directly, for 2^step generations in total.
+ *
+ * @param node
+ *      A node of level 2 or above.
+ *
+ * @param step
+ *      The power of two generations to advance, at most level-2.
+ *
+ * @return
+ *      The centre square of level k-1 after 2^step generations.
+ */
+
+const HashNode* HashLife::successor(const HashNode* node, int step){
+  int level=node->level;
+  if (node->population==0){
+    return this->empty(level-1);
+  }
+  bool full=(step==level-2);
+  if (full && node->result!=nullptr){
+    return node->result;
+  }
+  if (!full){
+    auto found=this->store->stepped.find(StepKey{node, step});
+    if (found!=this->store->stepped.end()){
+      return found->second;
+    }
+  }
+
+  const HashNode* result;
+  if (level==2){
+    result=this->step_leaves(node);
+  }
+  else{
+    const HashNode* nw=node->nw;
+    const HashNode* ne=node->ne;
+    const HashNode* sw=node->sw;
+    const HashNode* se=node->se;
+    //The nine overlapping squares of level k-1, row by row
+    const HashNode* n00=nw;
+    const HashNode* n01=this->join(nw->ne, ne->nw, nw->se, ne->sw);
+    const HashNode* n02=ne;
+    const HashNode* n10=this->join(nw->sw, nw->se, sw->nw, sw->ne);
+    const HashNode* n11=this->join(nw->se, ne->sw, sw->ne, se->nw);
+    const HashNode* n12=this->join(ne->sw, ne->se, se->nw, se->ne);
+    const HashNode* n20=sw;
+    const HashNode* n21=this->join(sw->ne, se->nw, sw->se, se->sw);
+    const HashNode* n22=se;
+    int inner=full ? level-3 : step;
+    const HashNode* c00=this->successor(n00, inner);
+    const HashNode* c01=this->successor(n01, inner);
+    const HashNode* c02=this->successor(n02, inner);
+    const HashNode* c10=this->successor(n10, inner);
+    const HashNode* c11=this->successor(n11, inner);
+    const HashNode* c12=this->successor(n12, inner);
+    const HashNode* c20=this->successor(n20, inner);
+    const HashNode* c21=this->successor(n21, inner);
+    const HashNode* c22=this->successor(n22, inner);
+    if (full){
+      result=this->join(this->successor(this->join(c00, c01, c10, c11), inner),
+                        this->successor(this->join(c01, c02, c11, c12), inner),
+                        this->successor(this->join(c10, c11, c20, c21), inner),
+                        this->successor(this->join(c11, c12, c21, c22), inner));
+    }
+    else{
+      result=this->join(this->join(c00->se, c01->sw, c10->ne, c11->nw),
+                        this->join(c01->se, c02->sw, c11->ne, c12->nw),
+                        this->join(c10->se, c11->sw, c20->ne, c21->nw),
+                        this->join(c11->se, c12->sw, c21->ne, c22->nw));
+    }
+  }
+
+  if (full){
+    node->result=result;
+  }
+  else{
+    this->store->stepped.emplace(StepKey{node, step}, result);
+  }
+  return result;
+}
+
+/**
+ * HashLife::build(grid, x, y, level)
+ *
+ * Private helper function to build the node for the square of a grid with its top left corner at x,y.
+ * Cells outside the grid are dead.
+ *
+ * @return
+ *      The canonical node for the square.
+ */
+
+const HashNode* HashLife::build(const Grid& grid, int x, int y, int level){
+  if (x>=grid.get_width() || y>=grid.get_height()){
+    return this->empty(level);
+  }
+  if (level==0){
+    return this->leaf(grid.row(y)[x]==Cell::ALIVE);
+  }
+  int half=1<<(level-1);
+  return this->join(this->build(grid, x, y, level-1), this->build(grid, x+half, y, level-1),
+                    this->build(grid, x, y+half, level-1), this->build(grid, x+half, y+half, level-1));
+}
+
+/**
+ * HashLife::is_centred()
+ *
+ * Private helper function to check every alive cell is inside the centre square of a quarter of the root's width.
+ * In the next 2^(level-3) generations nothing can then escape the centre square of half the root's width,
+ * which is the square HashLife::successor returns.
+ *
+ * @return
+ *      True if the root is padded by enough empty space.
+ */
+
+bool HashLife::is_centred() const{
+  const HashNode* r=this->root;
+  long long inner=r->nw->se->se->population+r->ne->sw->sw->population+
+                  r->sw->ne->ne->population+r->se->nw->nw->population;
+  return inner==r->population;
+}
+
+/**
+ * HashLife::expand()
+ *
+ * Private helper function to double the width of the root, keeping the existing root in the centre.
+ */
+
+void HashLife::expand(){
+  const HashNode* r=this->root;
+  const HashNode* e=this->empty(r->level-1);
+  this->root=this->join(this->join(e, e, e, r->nw), this->join(e, e, r->ne, e),
+                        this->join(e, r->sw, e, e), this->join(r->se, e, e, e));
+  long long half=1LL<<(r->level-1);
+  this->origin_x-=half;
+  this->origin_y-=half;
+}
+
+/**
+ * HashLife::get_generation()
+ *
+ * Gets the number of generations the plane has been advanced.
+ *
+ * @return
+ *      The current generation.
+ */
+
+long long HashLife::get_generation() const{
+  return this->generation;
+}
+
+/**
+ * HashLife::get_population()
+ *
+ * Counts the alive cells on the whole plane.
+ *
+ * @return
+ *      The number of alive cells.
+ */
+
+long long HashLife::get_population() const{
+  return this->root->population;
+}
+
+/**
+ * HashLife::get_nodes()
+ *
+ * Gets the number of nodes in the store, including those no longer reachable from the root until the next
+ * garbage collection.
+ *
+ * @return
+ *      The number of nodes.
+ */
+
+size_t HashLife::get_nodes() const{
+  return this->store->nodes.size();
+}
+
+/**
+ * HashLife::get_rule()
+ *
+ * Gets the rule the plane is advanced with.
+ *
+ * @return
+ *      The current rule.
+ */
+
+Rule HashLife::get_rule() const{
+  return this->store->rule;
+}
+
+/**
+ * HashLife::set_rule(rule)
+ *
+ * Change the rule the plane is advanced with.
+ * The memoised results were computed with the old rule, so the plane is moved into a node store of its own
+ * and every memoised result is forgotten.
+ *
+ * @param rule
+ *      The new rule.
+ *
+ * @throws
+ *      std::runtime_error if the rule gives birth with 0 neighbours.
+ */
+
+void HashLife::set_rule(const Rule& rule){
+  if (rule.next(false, 0)){
+    throw std::runtime_error("HashLife cannot run rules with B0 on an unbounded plane");
+  }
+  if (rule==this->store->rule){
+    return;
+  }
+  this->collect(false);
+  this->store->rule=rule;
+}
+
+/**
+ * HashLife::collect(keep_results)
+ *
+ * Private helper function to move the plane into a node store of its own holding only the nodes reachable from
+ * the root. Copies of the plane keep the old store, which is freed once none of them use it.
+ *
+ * @param keep_results
+ *      If true the memoised result of each kept node is kept too, when the result is itself a kept node.
+ *      Otherwise every memoised result is forgotten, as when the rule changes.
+ */
+
+void HashLife::collect(bool keep_results){
+  HashLife fresh;
+  fresh.store->rule=this->store->rule;
+  std::unordered_map<const HashNode*, const HashNode*> copied;
+  const HashNode* root=fresh.import(this->root, copied);
+  if (keep_results){
+    for (const auto& entry : copied){
+      if (entry.first->result!=nullptr){
+        auto result=copied.find(entry.first->result);
+        if (result!=copied.end()){
+          entry.second->result=result->second;
+        }
+      }
+    }
+  }
+  //Leave room to grow past the kept nodes, or a large pattern would be collected again straight away
+  fresh.store->limit=COLLECT_NODES;
+  if (fresh.store->nodes.size()*2>fresh.store->limit){
+    fresh.store->limit=fresh.store->nodes.size()*2;
+  }
+  this->store=fresh.store;
+  this->root=root;
+}
+
+/**
+ * HashLife::import(node, copied)
+ *
+ * Private helper function to rebuild a node of another HashLife's store in this one, without its memoised results.
+ *
+ * @param node
+ *      The node to rebuild.
+ *
+ * @param copied
+ *      The nodes rebuilt so far, so shared nodes are only rebuilt once.
+ *
+ * @return
+ *      The equivalent node in this store.
+ */
+
+const HashNode* HashLife::import(const HashNode* node, std::unordered_map<const HashNode*, const HashNode*>& copied){
+  if (node->level==0){
+    return this->leaf(node->population==1);
+  }
+  auto found=copied.find(node);
+  if (found!=copied.end()){
+    return found->second;
+  }
+  const HashNode* result=this->join(this->import(node->nw, copied), this->import(node->ne, copied),
+                                    this->import(node->sw, copied), this->import(node->se, copied));
+  copied.emplace(node, result);
+  return result;
+}
+
+/**
+ * HashLife::advance(generations)
+ *
+ * Advance the plane any number of generations.
+ * The count is split into powers of two, largest first, and each power 2^j is taken in a single
+ * HashLife::successor call on a root grown to at least level j+3. The node store is garbage collected
+ * before any power of two once it holds more nodes than its limit.
+ *
+ * @example
+ *
+ *      // Run an r-pentomino for a billion generations
+ *      HashLife life(Zoo::r_pentomino());
+ *      life.advance(1000000000);
+ *
+ * @param generations
+ *      The number of generations to advance.
+ *
+ * @throws
+ *      std::runtime_error if generations is negative, as the plane cannot be stepped backwards.
+ */
+
+void HashLife::advance(long long generations){
+  if (generations<0){
+    throw std::runtime_error("HashLife cannot advance a negative number of generations");
+  }
+  for (int step=62; step>=0; step--){
+    if (((generations>>step)&1)==0){
+      continue;
+    }
+    if (this->store->nodes.size()>this->store->limit){
+      this->collect(true);
+    }
+    while (this->root->level<step+3 || !this->is_centred()){
+      this->expand();
+    }
+    long long quarter=1LL<<(this->root->level-2);
+    this->root=this->successor(this->root, step);
+    this->origin_x+=quarter;
+    this->origin_y+=quarter;
+    this->generation+=1LL<<step;
+  }
+}
+
+/**
+ * HashLife::count(node, x, y, x0, y0, x1, y1)
+ *
+ * Private helper function to count the alive cells of a node at x,y that fall in the window [x0, x1) by [y0, y1).
+ * Nodes entirely inside the window use their stored population.
+ *
+ * @return
+ *      The number of alive cells in the window.
+ */
+
+long long HashLife::count(const HashNode* node, long long x, long long y,
+                          long long x0, long long y0, long long x1, long long y1) const{
+  long long size=1LL<<node->level;
+  if (node->population==0 || x>=x1 || y>=y1 || x+size<=x0 || y+size<=y0){
+    return 0;
+  }
+  if (x>=x0 && y>=y0 && x+size<=x1 && y+size<=y1){
+    return node->population;
+  }
+  long long half=size/2;
+  return this->count(node->nw, x, y, x0, y0, x1, y1)+this->count(node->ne, x+half, y, x0, y0, x1, y1)+
+         this->count(node->sw, x, y+half, x0, y0, x1, y1)+this->count(node->se, x+half, y+half, x0, y0, x1, y1);
+}
+
+/**
+ * HashLife::count_alive(x0, y0, width, height)
+ *
+ * Counts the alive cells in a window of the plane.
+ *
+ * @param x0, y0
+ *      The coordinate of the top left corner of the window.
+ *
+ * @param width, height
+ *      The size of the window.
+ *
+ * @return
+ *      The number of alive cells in the window.
+ */
+
+long long HashLife::count_alive(long long x0, long long y0, int width, int height) const{
+  return this->count(this->root, this->origin_x, this->origin_y, x0, y0, x0+width, y0+height);
+}
+
+/**
+ * HashLife::write(node, x, y, grid, x0, y0, alive)
+ *
+ * Private helper function to copy the alive cells of a node at x,y into a grid whose top left is at x0,y0.
+ * Empty nodes and nodes outside the grid are skipped.
+ */
+
+void HashLife::write(const HashNode* node, long long x, long long y, Grid& grid, long long x0, long long y0, int& alive) const{
+  long long size=1LL<<node->level;
+  if (node->population==0 || x>=x0+grid.get_width() || y>=y0+grid.get_height() || x+size<=x0 || y+size<=y0){
+    return;
+  }
+  if (node->level==0){
+    grid.row_data(y-y0, BulkKey())[x-x0]=Cell::ALIVE;
+    alive++;
+    return;
+  }
+  long long half=size/2;
+  this->write(node->nw, x, y, grid, x0, y0, alive);
+  this->write(node->ne, x+half, y, grid, x0, y0, alive);
+  this->write(node->sw, x, y+half, grid, x0, y0, alive);
+  this->write(node->se, x+half, y+half, grid, x0, y0, alive);
+}
+
+/**
+ * HashLife::to_grid(x0, y0, width, height)
+ *
+ * Copy a window of the plane into a Grid.
+ *
+ * @example
+ *
+ *      // Print the 32x32 cells to the right of and below the origin
+ *      std::cout << life.to_grid(0, 0, 32, 32) << std::endl;
+ *
+ * @param x0, y0
+ *      The coordinate of the top left corner of the window.
+ *
+ * @param width, height
+ *      The size of the window.
+ *
+ * @return
+ *      A Grid holding the cells of the window.
+ */
+
+Grid HashLife::to_grid(long long x0, long long y0, int width, int height) const{
+  Grid result(width, height);
+  this->to_grid(x0, y0, result);
+  return result;
+}
+
+/**
+ * HashLife::to_grid(x0, y0, result)
+ *
+ * Copy a window of the plane the size of an existing Grid into it, overwriting every cell in place.
+ *
+ * @example
+ *
+ *      // Copy the 32x32 cells to the right of and below the origin after every step into one Grid
+ *      Grid window(32, 32);
+ *      life.to_grid(0, 0, window);
+ *
+ * @param x0, y0
+ *      The coordinate of the top left corner of the window.
+ *
+ * @param result
+ *      The grid to copy into, its size giving the size of the window.
+ */
+
+void HashLife::to_grid(long long x0, long long y0, Grid& result) const{
+  result.renew(BulkKey());
+  for (int y=0; y<result.get_height(); y++){
+    Cell* out=result.row_data(y, BulkKey());
+    std::fill(out, out+result.get_width(), Cell::DEAD);
+  }
+  int alive=0;
+  this->write(this->root, this->origin_x, this->origin_y, result, x0, y0, alive);
+  result.set_alive_cells(alive, BulkKey());
+}
@@ -0,0 +1,100 @@
+/**
+ * Declares a class for simulating the Game of Life with Bill Gosper's HashLife algorithm.
+ * Rich documentation for the api and behaviour the HashLife class can be found in hashlife.cpp.
+ */
+#pragma once
+#include <deque>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+#include "grid.h"
+#include "rule.h"
+
+/**
+ * A HashNode is an immutable square of 2^level by 2^level cells, built from four quadrants of the level below.
+ * Level 0 nodes are single cells and have no quadrants.
+ */
+struct HashNode {
+    const HashNode* nw;
+    const HashNode* ne;
+    const HashNode* sw;
+    const HashNode* se;
+    int level;
+    long long population;
+    mutable const HashNode* result;
+};
+
+/**
+ * Declare the structure of the HashLife class for advancing a pattern on an unbounded plane.
+ *
+ * Identical squares are shared as a single canonical HashNode, and the result of advancing the centre of
+ * a node is memoised in the node, so repetitive patterns advance exponentially faster the longer they run.
+ */
+class HashLife {
+  private:
+    struct NodeKey {
+        const HashNode* nw;
+        const HashNode* ne;
+        const HashNode* sw;
+        const HashNode* se;
+        bool operator==(const NodeKey& other) const;
+    };
+    struct NodeKeyHash {
+        size_t operator()(const NodeKey& key) const;
+    };
+    struct StepKey {
+        const HashNode* node;
+        int step;
+        bool operator==(const StepKey& other) const;
+    };
+    struct StepKeyHash {
+        size_t operator()(const StepKey& key) const;
+    };
+    struct NodeStore {
+        std::deque<HashNode> nodes;
+        std::unordered_map<NodeKey, const HashNode*, NodeKeyHash> canonical;
+        std::unordered_map<StepKey, const HashNode*, StepKeyHash> stepped;
+        std::vector<const HashNode*> empty;
+        const HashNode* dead;
+        const HashNode* alive;
+        Rule rule;
+        size_t limit;
+    };
+
+    std::shared_ptr<NodeStore> store;
+    const HashNode* root;
+    long long origin_x;
+    long long origin_y;
+    long long generation;
+
+    const HashNode* leaf(bool alive);
+    const HashNode* join(const HashNode* nw, const HashNode* ne, const HashNode* sw, const HashNode* se);
+    const HashNode* empty(int level);
+    const HashNode* step_leaves(const HashNode* node);
+    const HashNode* successor(const HashNode* node, int step);
+    const HashNode* build(const Grid& grid, int x, int y, int level);
+    bool is_centred() const;
+    void expand();
+    void collect(bool keep_results);
+    const HashNode* import(const HashNode* node, std::unordered_map<const HashNode*, const HashNode*>& copied);
+    void write(const HashNode* node, long long x, long long y, Grid& grid, long long x0, long long y0, int& alive) const;
+    long long count(const HashNode* node, long long x, long long y,
+                    long long x0, long long y0, long long x1, long long y1) const;
+
+  public:
+    static const size_t COLLECT_NODES = 1 << 21;
+
+    HashLife();
+    explicit HashLife(const Grid& grid);
+    ~HashLife();
+
+    long long get_generation() const;
+    long long get_population() const;
+    size_t get_nodes() const;
+    Rule get_rule() const;
+    void set_rule(const Rule& rule);
+    void advance(long long generations);
+    long long count_alive(long long x0, long long y0, int width, int height) const;
+    Grid to_grid(long long x0, long long y0, int width, int height) const;
+    void to_grid(long long x0, long long y0, Grid& result) const;
+};
@@ -0,0 +1,350 @@
+/**
+ * Implements a class representing a bounded, delta compressed history of the generations of a world.
+ *      - Each generation is recorded as a bit-packed state, 8 cells per byte, read as 64-bit words.
+ *      - Every interval generations a keyframe is recorded, holding the whole state.
+ *      - The generations in between are recorded as deltas, the XOR of the state with the generation before it.
+ *      - Keyframes and deltas share one sparse encoding, only listing the words that are not zero.
+ *          - Each listed word is a variable length count of the zero words skipped before it, then its 8 bytes.
+ *          - A still or empty region of the world therefore costs nothing to record.
+ *
+ *      - The memory held by recorded frames is bounded by a byte budget rather than a number of generations.
+ *          - When over budget, the oldest keyframe is forgotten along with the deltas that depend on it.
+ *          - If the newest keyframe alone is over budget, the next generation starts a new keyframe early,
+ *            so at least the latest generation is always kept.
+ *          - A packed copy of the latest generation is kept on top of the budget to compute the next delta.
+ *
+ *      - Any recorded generation is rebuilt by decoding its keyframe and applying the deltas after it.
+ */
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include "history.h"
+
+/**
+ * History::History()
+ *
+ * Construct a history with no budget, which records nothing.
+ */
+
+History::History():History(0, 1){ }
+
+/**
+ * History::History(budget, interval)
+ *
+ * Construct an empty history.
+ *
+ * @example
+ *
+ *      // Remember up to 64MB of generations, with a keyframe every 100 generations
+ *      History history(64 << 20, 100);
+ *
+ * @param budget
+ *      The most bytes of frames to keep. A budget of 0 records nothing.
+ *
+ * @param interval
+ *      The number of generations from one keyframe to the next. Values below 1 are treated as 1.
+ */
+
+History::History(size_t budget, int interval):budget(budget), interval(interval), used(0), length(0),
+ sinceKeyframe(0), forceKeyframe(false){
+  if (this->interval<1){
+    this->interval=1;
+  }
+}
+
+size_t History::get_budget() const{
+  return this->budget;
+}
+
+int History::get_interval() const{
+  return this->interval;
+}
+
+/**
+ * History::get_used()
+ *
+ * Gets the number of bytes held by the recorded frames, counted against the budget.
+ *
+ * @return
+ *      The bytes used.
+ */
+
+size_t History::get_used() const{
+  return this->used;
+}
+
+bool History::empty() const{
+  return this->frames.empty();
+}
+
+/**
+ * History::get_first()
+ *
+ * Gets the oldest generation that can still be recalled.
+ *
+ * @return
+ *      The generation, or -1 if the history is empty.
+ */
+
+int64_t History::get_first() const{
+  if (this->frames.empty()){
+    return -1;
+  }
+  return this->frames.front().generation;
+}
+
+/**
+ * History::get_last()
+ *
+ * Gets the newest generation recorded.
+ *
+ * @return
+ *      The generation, or -1 if the history is empty.
+ */
+
+int64_t History::get_last() const{
+  if (this->frames.empty()){
+    return -1;
+  }
+  return this->frames.back().generation;
+}
+
+/**
+ * History::clear()
+ *
+ * Forget every recorded generation, keeping the budget and interval.
+ */
+
+void History::clear(){
+  this->frames.clear();
+  this->used=0;
+  this->sinceKeyframe=0;
+  this->forceKeyframe=false;
+}
+
+/**
+ * History::cost(frame)
+ *
+ * Private helper function to count the bytes a frame holds against the budget.
+ */
+
+size_t History::cost(const Frame& frame){
+  return sizeof(Frame)+frame.bytes.capacity();
+}
+
+/**
+ * History::encode(changes, bytes)
+ *
+ * Private helper function to sparsely encode a state or a delta, listing each word that is not zero
+ * after a variable length count of the zero words skipped before it.
+ *
+ * @param changes
+ *      The words to encode, as many as the recorded states are long.
+ *
+ * @param bytes
+ *      Filled with the encoding.
+ */
+
+void History::encode(const uint64_t* changes, std::vector<uint8_t>& bytes) const{
+  bytes.clear();
+  size_t next=0;
+  for (size_t i=0; i<this->latest.size(); i++){
+    if (changes[i]==0){
+      continue;
+    }
+    size_t gap=i-next;
+    while (gap>=128){
+      bytes.push_back((uint8_t)(gap|128));
+      gap>>=7;
+    }
+    bytes.push_back((uint8_t)gap);
+    uint8_t word[8];
+    std::memcpy(word, &changes[i], 8);
+    bytes.insert(bytes.end(), word, word+8);
+    next=i+1;
+  }
+}
+
+/**
+ * History::decode(bytes, state)
+ *
+ * Private helper function to XOR an encoded keyframe or delta into a state.
+ *
+ * @param bytes
+ *      The encoding.
+ *
+ * @param state
+ *      The words to apply it to. A keyframe is applied to a state of all zero words.
+ */
+
+void History::decode(const std::vector<uint8_t>& bytes, std::vector<uint64_t>& state) const{
+  size_t position=0;
+  size_t i=0;
+  while (i<bytes.size()){
+    size_t gap=0;
+    int shift=0;
+    while (bytes[i]&128){
+      gap|=(size_t)(bytes[i]&127)<<shift;
+      shift+=7;
+      i++;
+    }
+    gap|=(size_t)bytes[i]<<shift;
+    i++;
+    position+=gap;
+    uint64_t word;
+    std::memcpy(&word, bytes.data()+i, 8);
+    state[position]^=word;
+    i+=8;
+    position++;
+  }
+}
+
+/**
+ * History::record(generation, packed, length)
+ *
+ * Record the next generation. Generations must be recorded one after another. Recording a generation that does not
+ * follow the last one, or a state of a different length, forgets the history and starts again from this one.
+ *
+ * @example
+ *
+ *      // Record a world after every step
+ *      world.step();
+ *      history.record(generation, packed.data(), packed.size());
+ *
+ * @param generation
+ *      The generation of the state.
+ *
+ * @param packed
+ *      The bit-packed state.
+ *
+ * @param length
+ *      The length of the packed state in bytes.
+ */
+
+void History::record(int64_t generation, const uint8_t* packed, size_t length){
+  if (this->budget==0){
+    return;
+  }
+  size_t count=(length+7)/8;
+  if (length!=this->length || (!this->frames.empty() && generation!=this->frames.back().generation+1)){
+    this->clear();
+    this->length=length;
+    this->latest.assign(count, 0);
+  }
+  this->words.resize(count);
+  if (count>0){
+    this->words[count-1]=0;
+    std::memcpy(this->words.data(), packed, length);
+  }
+
+  bool keyframe=this->frames.empty() || this->forceKeyframe || this->sinceKeyframe+1>=this->interval;
+  if (keyframe){
+    this->encode(this->words.data(), this->encoded);
+    this->sinceKeyframe=0;
+    this->forceKeyframe=false;
+  }
+  else{
+    //The latest state is about to be replaced, so turn it into the delta in place
+    for (size_t i=0; i<count; i++){
+      this->latest[i]^=this->words[i];
+    }
+    this->encode(this->latest.data(), this->encoded);
+    this->sinceKeyframe++;
+  }
+  std::swap(this->latest, this->words);
+
+  this->frames.push_back(Frame{generation, keyframe, std::vector<uint8_t>(this->encoded.begin(), this->encoded.end())});
+  this->used+=cost(this->frames.back());
+  this->evict();
+}
+
+/**
+ * History::evict()
+ *
+ * Private helper function to forget the oldest keyframes, and the deltas after them, until the budget is met.
+ * The newest keyframe is never forgotten. If it is all that is left and still over budget, the next generation
+ * recorded is made a keyframe so the one before it can be forgotten.
+ */
+
+void History::evict(){
+  while (this->used>this->budget){
+    size_t next=1;
+    while (next<this->frames.size() && !this->frames[next].keyframe){
+      next++;
+    }
+    if (next==this->frames.size()){
+      this->forceKeyframe=true;
+      return;
+    }
+    for (size_t i=0; i<next; i++){
+      this->used-=cost(this->frames.front());
+      this->frames.pop_front();
+    }
+  }
+}
+
+/**
+ * History::state_at(generation, packed)
+ *
+ * Rebuild a recorded generation from its keyframe and the deltas after it.
+ *
+ * @param generation
+ *      The generation to rebuild, from History::get_first() to History::get_last().
+ *
+ * @param packed
+ *      Filled with the bit-packed state.
+ *
+ * @throws
+ *      std::runtime_error if the generation is not in the history.
+ */
+
+void History::state_at(int64_t generation, std::vector<uint8_t>& packed) const{
+  if (this->frames.empty() || generation<this->get_first() || generation>this->get_last()){
+    throw std::runtime_error("Generation "+std::to_string(generation)+" is not in the history");
+  }
+  size_t index=generation-this->get_first();
+  size_t keyframe=index;
+  while (!this->frames[keyframe].keyframe){
+    keyframe--;
+  }
+  std::vector<uint64_t> state(this->latest.size(), 0);
+  for (size_t i=keyframe; i<=index; i++){
+    this->decode(this->frames[i].bytes, state);
+  }
+  packed.resize(this->length);
+  std::memcpy(packed.data(), state.data(), this->length);
+}
+
+/**
+ * History::truncate(generation)
+ *
+ * Forget every generation after the given one, so recording can carry on from it, as after stepping back in time.
+ * Truncating before the oldest generation forgets everything.
+ *
+ * @param generation
+ *      The newest generation to keep.
+ */
+
+void History::truncate(int64_t generation){
+  if (this->frames.empty() || generation>=this->get_last()){
+    return;
+  }
+  if (generation<this->get_first()){
+    this->clear();
+    return;
+  }
+  std::vector<uint8_t> packed;
+  this->state_at(generation, packed);
+  while (this->frames.back().generation>generation){
+    this->used-=cost(this->frames.back());
+    this->frames.pop_back();
+  }
+  std::fill(this->latest.begin(), this->latest.end(), 0);
+  std::memcpy(this->latest.data(), packed.data(), this->length);
+  this->sinceKeyframe=0;
+  for (size_t i=this->frames.size()-1; !this->frames[i].keyframe; i--){
+    this->sinceKeyframe++;
+  }
+  this->forceKeyframe=false;
+}
@@ -0,0 +1,59 @@
+/**
+ * Declares a class representing a bounded, delta compressed history of the generations of a world.
+ * Rich documentation for the api and behaviour the History class can be found in history.cpp.
+ */
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+/**
+ * Declare the structure of the History class for recalling recent generations of a world.
+ *
+ * Generations are recorded as bit-packed states, 8 cells per byte. Every few generations a keyframe holds a whole
+ * state, and the generations between keyframes hold only the bits that changed since the generation before.
+ * Both are stored sparsely, so empty regions and regions that did not change take no space.
+ */
+class History {
+  private:
+    /**
+     * A Frame is one recorded generation, either a keyframe or a delta from the generation before it.
+     */
+    struct Frame {
+        int64_t generation;
+        bool keyframe;
+        std::vector<uint8_t> bytes;
+    };
+
+    size_t budget;
+    int interval;
+    size_t used;
+    size_t length;
+    std::deque<Frame> frames;
+    std::vector<uint64_t> latest;
+    std::vector<uint64_t> words;
+    std::vector<uint8_t> encoded;
+    int sinceKeyframe;
+    bool forceKeyframe;
+
+    static size_t cost(const Frame& frame);
+    void encode(const uint64_t* changes, std::vector<uint8_t>& bytes) const;
+    void decode(const std::vector<uint8_t>& bytes, std::vector<uint64_t>& state) const;
+    void evict();
+
+  public:
+    History();
+    History(size_t budget, int interval);
+
+    size_t get_budget() const;
+    int get_interval() const;
+    size_t get_used() const;
+    bool empty() const;
+    int64_t get_first() const;
+    int64_t get_last() const;
+    void clear();
+    void record(int64_t generation, const uint8_t* packed, size_t length);
+    void state_at(int64_t generation, std::vector<uint8_t>& packed) const;
+    void truncate(int64_t generation);
+};
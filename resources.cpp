@@ -0,0 +1,289 @@
+/**
+ * Implements the memory resources a Grid can allocate its cells from, passed to it as a std::pmr::memory_resource.
+ *      - AlignedResource starts every block on a 64 byte cache line, so rows of a multiple of 64 cells never
+ *        straddle one more cache line than they need to.
+ *      - HugePageResource maps large blocks on 2MB huge pages, so stepping a multi-GB world misses the TLB
+ *        once per 2MB rather than once per 4KB.
+ *          - Explicit huge pages are asked for first with MAP_HUGETLB, which only succeeds if the system has
+ *            reserved some in /proc/sys/vm/nr_hugepages.
+ *          - Otherwise the block is mapped normally and advised with MADV_HUGEPAGE, so transparent huge pages
+ *            back it where the kernel allows them.
+ *          - Successive blocks start at one of 16 staggered offsets into their first huge page. Two grids
+ *            starting on huge page boundaries map their matching rows onto the same cache sets, which made
+ *            stepping a 4096x4096 world 3 times slower.
+ *          - Blocks smaller than a huge page come from AlignedResource.
+ *      - ArenaResource bump allocates from large chunks and frees nothing until it is destroyed, for the
+ *        short lived grids made by cropping and rotating.
+ *
+ * A resource must outlive every grid allocated from it, including the copies which share their cells.
+ *
+ * UntouchedAllocator hands a Grid the blocks of its resource without writing them, so a buffer is only placed
+ * on a NUMA node once a thread writes it, and add_placement asks the kernel which nodes a block ended up on.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "resources.h"
+
+/**
+ * AlignedResource::do_allocate(bytes, alignment)
+ *
+ * Allocate a block starting on a cache line, or on a larger alignment if one is asked for.
+ *
+ * @param bytes
+ *      The size of the block.
+ *
+ * @param alignment
+ *      The alignment asked for by the container.
+ *
+ * @return
+ *      The block.
+ *
+ * @throws
+ *      std::bad_alloc if there is not enough memory.
+ */
+
+void* AlignedResource::do_allocate(size_t bytes, size_t alignment){
+  return ::operator new(bytes, std::align_val_t(std::max(alignment, CACHE_LINE)));
+}
+
+void AlignedResource::do_deallocate(void* block, size_t bytes, size_t alignment){
+  ::operator delete(block, bytes, std::align_val_t(std::max(alignment, CACHE_LINE)));
+}
+
+bool AlignedResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept{
+  return dynamic_cast<const AlignedResource*>(&other)!=nullptr;
+}
+
+/**
+ * HugePageResource::HugePageResource()
+ *
+ * Construct a resource with no blocks mapped yet.
+ *
+ * @example
+ *
+ *      // Make a 100000x100000 grid on huge pages
+ *      HugePageResource huge;
+ *      Grid grid(100000, 100000, &huge);
+ */
+
+HugePageResource::HugePageResource():hugeBytes(0), advisedBytes(0), blocks(0){ }
+
+/**
+ * HugePageResource::get_huge_bytes()
+ *
+ * Gets the number of bytes mapped so far on explicit huge pages with MAP_HUGETLB.
+ *
+ * @return
+ *      The number of bytes.
+ */
+
+size_t HugePageResource::get_huge_bytes() const{
+  return this->hugeBytes;
+}
+
+/**
+ * HugePageResource::get_advised_bytes()
+ *
+ * Gets the number of bytes mapped so far on normal pages and advised to become transparent huge pages.
+ *
+ * @return
+ *      The number of bytes.
+ */
+
+size_t HugePageResource::get_advised_bytes() const{
+  return this->advisedBytes;
+}
+
+/**
+ * HugePageResource::do_allocate(bytes, alignment)
+ *
+ * Map a block of a whole number of huge pages, falling back to transparent huge pages when no explicit
+ * ones are free. A mapping starts on a huge page, and the block starts at a staggered offset into it, which is
+ * a multiple of 256 bytes. An offset is rounded up to any larger alignment the container asks for, and blocks
+ * aligned to more than a huge page come from AlignedResource.
+ *
+ * @param bytes
+ *      The size of the block.
+ *
+ * @param alignment
+ *      The alignment asked for by the container.
+ *
+ * @return
+ *      The block.
+ *
+ * @throws
+ *      std::bad_alloc if the block cannot be mapped.
+ */
+
+void* HugePageResource::do_allocate(size_t bytes, size_t alignment){
+  if (bytes<HUGE_PAGE_SIZE || alignment>HUGE_PAGE_SIZE){
+    return aligned_resource()->allocate(bytes, alignment);
+  }
+  //Blocks starting at the same offset into a huge page fight over the same cache sets, so each block starts
+  //a few cache lines and a page further into its first huge page than the block before it
+  size_t offset=(this->blocks++%COLOURS)*(4096+4*AlignedResource::CACHE_LINE);
+  //Alignments are powers of two, so an offset rounded up to a whole huge page wraps to 0 and stays aligned
+  offset=(offset+alignment-1)/alignment*alignment%HUGE_PAGE_SIZE;
+  size_t length=(offset+bytes+HUGE_PAGE_SIZE-1)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE;
+  void* block=mmap(nullptr, length, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS|MAP_HUGETLB, -1, 0);
+  if (block!=MAP_FAILED){
+    this->hugeBytes+=length;
+    return (char*)block+offset;
+  }
+  //Transparent huge pages only back whole aligned 2MB ranges, so map one page more and trim the block onto a boundary
+  block=mmap(nullptr, length+HUGE_PAGE_SIZE, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+  if (block==MAP_FAILED){
+    throw std::bad_alloc();
+  }
+  char* mapped=(char*)block;
+  char* start=(char*)(((uintptr_t)mapped+HUGE_PAGE_SIZE-1)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE);
+  if (start>mapped){
+    munmap(mapped, start-mapped);
+  }
+  munmap(start+length, mapped+HUGE_PAGE_SIZE-start);
+  //Advice is only a hint, so a kernel without transparent huge pages still gets a working block
+  madvise(start, length, MADV_HUGEPAGE);
+  this->advisedBytes+=length;
+  return start+offset;
+}
+
+void HugePageResource::do_deallocate(void* block, size_t bytes, size_t alignment){
+  if (bytes<HUGE_PAGE_SIZE || alignment>HUGE_PAGE_SIZE){
+    aligned_resource()->deallocate(block, bytes, alignment);
+    return;
+  }
+  //Every block starts less than a huge page into its mapping, which starts on a huge page
+  char* start=(char*)((uintptr_t)block/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE);
+  size_t offset=(char*)block-start;
+  munmap(start, (offset+bytes+HUGE_PAGE_SIZE-1)/HUGE_PAGE_SIZE*HUGE_PAGE_SIZE);
+}
+
+bool HugePageResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept{
+  return this==&other;
+}
+
+/**
+ * ArenaResource::ArenaResource(initial_size)
+ *
+ * Construct an arena which bump allocates from cache line aligned chunks, the first of the given size and
+ * each one after it larger. Freeing a block does nothing, and every chunk is freed when the arena is destroyed.
+ * An arena is not thread safe, so it should only be used by one thread at a time.
+ *
+ * @example
+ *
+ *      // Rotate and crop a grid in an arena, freeing both results at the end of the scope
+ *      {
+ *          ArenaResource arena(1 << 20);
+ *          Grid rotated = grid.rotate(1, &arena);
+ *          Grid corner(rotated.crop(0, 0, 8, 8), &arena);
+ *          std::cout << corner << std::endl;
+ *      }
+ *
+ * @param initial_size
+ *      The size of the first chunk in bytes.
+ */
+
+ArenaResource::ArenaResource(size_t initial_size):std::pmr::monotonic_buffer_resource(initial_size, aligned_resource()){ }
+
+/**
+ * aligned_resource()
+ *
+ * Gets the AlignedResource shared by the whole program.
+ *
+ * @example
+ *
+ *      // Allocate every grid on cache lines from now on
+ *      std::pmr::set_default_resource(aligned_resource());
+ *
+ * @return
+ *      The resource.
+ */
+
+AlignedResource* aligned_resource(){
+  static AlignedResource resource;
+  return &resource;
+}
+
+/**
+ * huge_page_resource()
+ *
+ * Gets the HugePageResource shared by the whole program.
+ *
+ * @example
+ *
+ *      // Allocate every grid on huge pages from now on
+ *      std::pmr::set_default_resource(huge_page_resource());
+ *
+ * @return
+ *      The resource.
+ */
+
+HugePageResource* huge_page_resource(){
+  static HugePageResource resource;
+  return &resource;
+}
+
+/**
+ * add_placement(block, bytes, nodes)
+ *
+ * Adds up how many bytes of a block sit on each NUMA node, asking the kernel where each page lives with the
+ * move_pages system call. Pages never written yet live nowhere and are not counted.
+ *
+ * @example
+ *
+ *      // Print the share of a grid on each node
+ *      std::vector<size_t> nodes;
+ *      add_placement(grid.row(0), grid.get_total_cells(), nodes);
+ *      for (size_t node=0; node<nodes.size(); node++) {
+ *          std::cout << "Node " << node << ": " << nodes[node] << " bytes" << std::endl;
+ *      }
+ *
+ * @param block
+ *      The start of the block.
+ *
+ * @param bytes
+ *      The size of the block.
+ *
+ * @param nodes
+ *      The number of bytes on each node, indexed by node, grown to fit every node the block is found on.
+ *
+ * @throws
+ *      std::runtime_error if the kernel cannot report the placement.
+ */
+
+void add_placement(const void* block, size_t bytes, std::vector<size_t>& nodes){
+  const size_t page=sysconf(_SC_PAGESIZE);
+  const size_t BATCH=4096;
+  std::vector<void*> pages;
+  std::vector<int> status;
+  uintptr_t first=(uintptr_t)block/page*page;
+  uintptr_t last=(uintptr_t)block+bytes;
+  //Ask about the pages a batch at a time, so a block of many GB never needs a list of every page
+  for (uintptr_t start=first; start<last; start+=BATCH*page){
+    pages.clear();
+    for (uintptr_t address=start; address<last && address<start+BATCH*page; address+=page){
+      pages.push_back((void*)address);
+    }
+    status.assign(pages.size(), 0);
+    if (syscall(SYS_move_pages, 0, pages.size(), pages.data(), nullptr, status.data(), 0)!=0){
+      throw std::runtime_error("Could not read the placement of the block: "+std::string(std::strerror(errno)));
+    }
+    for (int node : status){
+      if (node<0){
+        continue;
+      }
+      if ((size_t)node>=nodes.size()){
+        nodes.resize(node+1, 0);
+      }
+      nodes[node]+=page;
+    }
+  }
+}
@@ -0,0 +1,81 @@
+/**
+ * Declares the memory resources a Grid can allocate its cells from.
+ * Rich documentation for the api and behaviour of the resources can be found in resources.cpp.
+ */
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <memory_resource>
+#include <new>
+#include <vector>
+
+/**
+ * Declare the structure of the AlignedResource class for allocating blocks starting on a cache line.
+ */
+class AlignedResource : public std::pmr::memory_resource {
+  public:
+    static constexpr size_t CACHE_LINE=64;
+
+  private:
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* block, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+/**
+ * Declare the structure of the HugePageResource class for allocating large blocks backed by huge pages.
+ */
+class HugePageResource : public std::pmr::memory_resource {
+  public:
+    static constexpr size_t HUGE_PAGE_SIZE=2*1024*1024;
+    static constexpr size_t COLOURS=16;
+
+    HugePageResource();
+    size_t get_huge_bytes() const;
+    size_t get_advised_bytes() const;
+
+  private:
+    std::atomic<size_t> hugeBytes;
+    std::atomic<size_t> advisedBytes;
+    std::atomic<size_t> blocks;
+
+    void* do_allocate(size_t bytes, size_t alignment) override;
+    void do_deallocate(void* block, size_t bytes, size_t alignment) override;
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+};
+
+/**
+ * Declare the structure of the ArenaResource class for bump allocating short lived grids, freed all at once.
+ */
+class ArenaResource : public std::pmr::monotonic_buffer_resource {
+  public:
+    explicit ArenaResource(size_t initial_size);
+    ArenaResource(const ArenaResource&) = delete;
+    ArenaResource& operator=(const ArenaResource&) = delete;
+};
+
+/**
+ * Declare the structure of the UntouchedAllocator class, a std::pmr::polymorphic_allocator which leaves the
+ * elements a container makes without a value unwritten, so their pages are not touched until they are first used.
+ */
+template <typename T>
+class UntouchedAllocator : public std::pmr::polymorphic_allocator<T> {
+  public:
+    using std::pmr::polymorphic_allocator<T>::polymorphic_allocator;
+    using std::pmr::polymorphic_allocator<T>::construct;
+    UntouchedAllocator() = default;
+    UntouchedAllocator(const std::pmr::polymorphic_allocator<T>& other):std::pmr::polymorphic_allocator<T>(other){ }
+
+    template <typename U>
+    void construct(U* element){
+        ::new((void*)element) U;
+    }
+
+    UntouchedAllocator select_on_container_copy_construction() const{
+        return UntouchedAllocator();
+    }
+};
+
+AlignedResource* aligned_resource();
+HugePageResource* huge_page_resource();
+void add_placement(const void* block, size_t bytes, std::vector<size_t>& nodes);
@@ -0,0 +1,65 @@
+/**
+ * Declares the row kernel shared by the engines that step worlds held as 0/1 bytes, one byte per cell.
+ *      - Each row is stepped in two passes. The first sums every column of the three rows around it, and the
+ *        second adds three neighbouring column sums, less the cell itself, and looks the result up in a packed rule.
+ *      - Neither pass branches, so the compiler can vectorise both.
+ *      - Engine::TEMPORAL uses the kernel on the buffers it steps several generations at a time.
+ *      - Ensemble uses it on every world of the ensemble, and DistributedWorld on the strip of every worker.
+ */
+#pragma once
+#include <cstdint>
+
+/**
+ * sum_columns(up, mid, down, sums, x0, x1)
+ *
+ * Sums each column of three rows.
+ *
+ * @param up, mid, down
+ *      The row above, the row itself and the row below.
+ *
+ * @param sums
+ *      Set to the sum of each column from x0 up to but not including x1, indexed the same as the rows.
+ *
+ * @param x0, x1
+ *      The first column to sum and the column after the last.
+ */
+
+inline void sum_columns(const uint8_t* up, const uint8_t* mid, const uint8_t* down, uint8_t* sums, int x0, int x1){
+  for (int x=x0; x<x1; x++){
+    sums[x]=up[x]+mid[x]+down[x];
+  }
+}
+
+/**
+ * step_columns(sums, mid, out, x0, x1, rule)
+ *
+ * Steps the cells of a row from the column sums of the three rows around it.
+ *
+ * @param sums
+ *      The column sums from sum_columns, including the column either side of x0 and x1 - 1.
+ *
+ * @param mid
+ *      The row being stepped.
+ *
+ * @param out
+ *      Set to the next value of each cell from x0 up to but not including x1.
+ *
+ * @param x0, x1
+ *      The first column to step and the column after the last.
+ *
+ * @param rule
+ *      The rule packed by Rule::packed().
+ *
+ * @return
+ *      The number of alive cells written.
+ */
+
+inline int step_columns(const uint8_t* sums, const uint8_t* mid, uint8_t* out, int x0, int x1, uint32_t rule){
+  int alive=0;
+  for (int x=x0; x<x1; x++){
+    int count=sums[x-1]+sums[x]+sums[x+1]-mid[x];
+    out[x]=(rule>>(count+9*mid[x]))&1;
+    alive+=out[x];
+  }
+  return alive;
+}
@@ -0,0 +1,100 @@
+/**
+ * Implements a class representing an outer-totalistic cellular automaton rule such as B3/S23.
+ *      - A dead cell is born if its number of alive neighbours is one of the birth counts.
+ *      - An alive cell survives if its number of alive neighbours is one of the survival counts.
+ *      - https://www.conwaylife.com/wiki/Rulestring
+ *
+ *      - Rules can be parsed from and written back to B/S rulestrings.
+ *          - e.g. B3/S23 is Conway's Game of Life, B36/S23 is HighLife, B3678/S34678 is Day & Night.
+ *          - The B and S parts may come in either order and in either case, separated by a '/'.
+ */
+#include <stdexcept>
+#include <cctype>
+#include "rule.h"
+
+/**
+ * Rule::parse(rulestring)
+ *
+ * Parse a B/S rulestring into a rule.
+ *
+ * @example
+ *
+ *      // Parse HighLife from the command line
+ *      Rule rule = Rule::parse("B36/S23");
+ *
+ * @param rulestring
+ *      The rulestring, e.g. "B3/S23".
+ *
+ * @return
+ *      The parsed rule.
+ *
+ * @throws
+ *      std::runtime_error if the rulestring is not a B part and an S part of digits 0 to 8 separated by a '/'.
+ */
+
+Rule Rule::parse(const std::string& rulestring){
+  size_t slash=rulestring.find('/');
+  if (slash==std::string::npos){
+    throw std::runtime_error("Rulestring must look like B3/S23: "+rulestring);
+  }
+  std::string parts[2]={rulestring.substr(0, slash), rulestring.substr(slash+1)};
+  uint16_t masks[2]={0, 0};
+  bool seen[2]={false, false};
+  for (const std::string& part : parts){
+    if (part.empty()){
+      throw std::runtime_error("Rulestring must look like B3/S23: "+rulestring);
+    }
+    int which;
+    char letter=std::toupper((unsigned char)part[0]);
+    if (letter=='B'){
+      which=0;
+    }
+    else if (letter=='S'){
+      which=1;
+    }
+    else{
+      throw std::runtime_error("Rulestring must look like B3/S23: "+rulestring);
+    }
+    if (seen[which]){
+      throw std::runtime_error("Rulestring has two "+std::string(1, letter)+" parts: "+rulestring);
+    }
+    seen[which]=true;
+    for (size_t i=1; i<part.length(); i++){
+      if (part[i]<'0' || part[i]>'8'){
+        throw std::runtime_error("Neighbour counts must be digits from 0 to 8: "+rulestring);
+      }
+      masks[which]|=(uint16_t)(1<<(part[i]-'0'));
+    }
+  }
+  return Rule(masks[0], masks[1]);
+}
+
+/**
+ * Rule::to_string()
+ *
+ * Write the rule as a B/S rulestring, with the counts in increasing order.
+ *
+ * @example
+ *
+ *      // Prints B3/S23
+ *      std::cout << Rule().to_string() << std::endl;
+ *
+ * @return
+ *      The rulestring.
+ */
+
+std::string Rule::to_string() const{
+  std::string result="B";
+  for (int n=0; n<9; n++){
+    if ((this->birth>>n)&1){
+      result+=(char)('0'+n);
+    }
+  }
+  result+="/S";
+  for (int n=0; n<9; n++){
+    if ((this->survival>>n)&1){
+      result+=(char)('0'+n);
+    }
+  }
+  return result;
+}
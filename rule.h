@@ -0,0 +1,180 @@
+/**
+ * Declares a class representing an outer-totalistic cellular automaton rule such as B3/S23.
+ * Rich documentation for the api and behaviour the Rule class can be found in rule.cpp.
+ */
+#pragma once
+#include <cstdint>
+#include <string>
+
+/**
+ * Declare the structure of the Rule class for deciding the next value of a cell from its neighbour count.
+ *
+ * The rule is stored as an 18 entry transition table, entry (alive * 9 + count) holding whether a cell
+ * with that many alive neighbours is alive in the next generation. The constructors are constexpr, so
+ * a rule written in the source is compiled to its table at compile time.
+ */
+class Rule {
+  private:
+    uint16_t birth;
+    uint16_t survival;
+    bool table[18];
+
+  public:
+    /**
+     * Rule::counts(digits)
+     *
+     * Turn a string of neighbour counts such as "36" into a bit mask with bit n set for each count n.
+     * Usable at compile time, e.g. Rule(Rule::counts("36"), Rule::counts("23")) for HighLife.
+     */
+    static constexpr uint16_t counts(const char* digits){
+      uint16_t mask=0;
+      for (int i=0; digits[i]!='\0'; i++){
+        mask|=(uint16_t)(1<<(digits[i]-'0'));
+      }
+      return mask;
+    }
+
+    /**
+     * Rule::Rule()
+     *
+     * Construct the rule of Conway's Game of Life, B3/S23.
+     */
+    constexpr Rule():Rule(counts("3"), counts("23")){}
+
+    /**
+     * Rule::Rule(birth, survival)
+     *
+     * Construct a rule from bit masks of the neighbour counts a dead cell is born with and an alive cell survives with.
+     * Bits above bit 8 are ignored.
+     */
+    constexpr Rule(uint16_t birth, uint16_t survival):birth(birth&511), survival(survival&511), table{}{
+      for (int n=0; n<9; n++){
+        this->table[n]=(this->birth>>n)&1;
+        this->table[9+n]=(this->survival>>n)&1;
+      }
+    }
+
+    /**
+     * Rule::next(alive, count)
+     *
+     * Look up whether a cell is alive in the next generation.
+     *
+     * @param alive
+     *      Whether the cell is alive now.
+     *
+     * @param count
+     *      The number of alive neighbours of the cell, from 0 to 8.
+     *
+     * @return
+     *      True if the cell is alive in the next generation.
+     */
+    constexpr bool next(bool alive, int count) const{
+      return this->table[alive*9+count];
+    }
+
+    constexpr uint16_t get_birth() const{
+      return this->birth;
+    }
+
+    constexpr uint16_t get_survival() const{
+      return this->survival;
+    }
+
+    /**
+     * Rule::packed()
+     *
+     * Pack the transition table into one word for kernels that step a cell with a shift rather than an index.
+     * Bit n is whether a dead cell with n neighbours is born, bit 9+n whether an alive one survives,
+     * so the next value of a cell is (packed() >> (count + 9 * alive)) & 1.
+     */
+    constexpr uint32_t packed() const{
+      return (uint32_t)this->birth|((uint32_t)this->survival<<9);
+    }
+
+    constexpr bool operator==(const Rule& other) const{
+      return this->birth==other.birth && this->survival==other.survival;
+    }
+
+    constexpr bool operator!=(const Rule& other) const{
+      return !(*this==other);
+    }
+
+    /**
+     * Rule::next_bits(alive, bit0, bit1, bit2, bit3)
+     *
+     * Apply the rule to 64 cells at once, given their neighbour counts split into four bit planes.
+     *
+     * @param alive
+     *      The cells, one per bit.
+     *
+     * @param bit0, bit1, bit2, bit3
+     *      The ones, twos, fours and eights bits of the neighbour count of each cell.
+     *
+     * @return
+     *      The cells in the next generation, one per bit.
+     */
+    constexpr uint64_t next_bits(uint64_t alive, uint64_t bit0, uint64_t bit1, uint64_t bit2, uint64_t bit3) const{
+      uint64_t next=0;
+      for (int n=0; n<9; n++){
+        uint64_t when=0;
+        if ((this->birth>>n)&1){
+          when|=~alive;
+        }
+        if ((this->survival>>n)&1){
+          when|=alive;
+        }
+        if (when==0){
+          continue;
+        }
+        uint64_t equal=((n&1) ? bit0 : ~bit0)&((n&2) ? bit1 : ~bit1)&((n&4) ? bit2 : ~bit2)&((n&8) ? bit3 : ~bit3);
+        next|=equal&when;
+      }
+      return next;
+    }
+
+    static Rule parse(const std::string& rulestring);
+    std::string to_string() const;
+};
+
+/**
+ * A StaticRule gives a Rule fixed by template parameters as a compile time constant.
+ *
+ * Kernels templated on the type of their rule take either a Rule or a StaticRule. Given a StaticRule the compiler
+ * sees every count of the rule, so it drops the counts the rule never uses, and a rule can be given a hand written
+ * kernel of its own by specialising StaticRule::next_bits, as ConwayRule is.
+ *
+ * @example
+ *
+ *      // HighLife, B36/S23, with its transition table built by the compiler
+ *      constexpr Rule highlife = StaticRule<Rule::counts("36"), Rule::counts("23")>::rule;
+ */
+template <uint16_t Birth, uint16_t Survival>
+struct StaticRule {
+    static_assert(Birth<512 && Survival<512, "Neighbour counts only go up to 8");
+    static constexpr Rule rule=Rule(Birth, Survival);
+
+    /**
+     * StaticRule::next_bits(alive, bit0, bit1, bit2, bit3)
+     *
+     * Apply the rule to 64 cells at once, as Rule::next_bits does.
+     */
+    static inline uint64_t next_bits(uint64_t alive, uint64_t bit0, uint64_t bit1, uint64_t bit2, uint64_t bit3){
+      return rule.next_bits(alive, bit0, bit1, bit2, bit3);
+    }
+};
+
+/**
+ * ConwayRule is Conway's Game of Life, B3/S23, as a StaticRule.
+ */
+typedef StaticRule<Rule::counts("3"), Rule::counts("23")> ConwayRule;
+
+/**
+ * ConwayRule::next_bits(alive, bit0, bit1, bit2, bit3)
+ *
+ * Conway's rule reduces to two or three neighbours, and alive or exactly three, a quarter of the operations
+ * Rule::next_bits spends on it.
+ */
+template <>
+inline uint64_t ConwayRule::next_bits(uint64_t alive, uint64_t bit0, uint64_t bit1, uint64_t bit2, uint64_t bit3){
+  return bit1&~bit2&~bit3&(bit0|alive);
+}
@@ -0,0 +1,120 @@
+/**
+ * Implements a class representing a bounded queue of world snapshots passed from a simulation thread to an output thread.
+ *      - The simulation thread pushes snapshots, and never touches a snapshot again once it is pushed.
+ *      - The output thread pops snapshots in order, and formats and writes them at its own pace.
+ *      - The queue holds at most its capacity of snapshots, so memory stays bounded however slow the output is.
+ *          - With DropPolicy::BLOCK a full queue makes the simulation thread wait.
+ *          - With DropPolicy::SKIP_STALE a full queue drops its oldest snapshot instead.
+ *      - Closing the queue lets the output thread drain the remaining snapshots and then stop.
+ */
+#include <utility>
+#include "snapshotqueue.h"
+
+/**
+ * SnapshotQueue::SnapshotQueue(capacity, policy)
+ *
+ * Construct an empty queue.
+ *
+ * @example
+ *
+ *      // Triple buffering: one snapshot being written, and two waiting, dropping stale ones
+ *      SnapshotQueue queue(2, DropPolicy::SKIP_STALE);
+ *
+ * @param capacity
+ *      The most snapshots waiting in the queue. Values below 1 are treated as 1.
+ *
+ * @param policy
+ *      What to do when pushing to a full queue.
+ */
+
+SnapshotQueue::SnapshotQueue(size_t capacity, DropPolicy policy):capacity(capacity), policy(policy),
+ closed(false), dropped(0){
+  if (this->capacity<1){
+    this->capacity=1;
+  }
+}
+
+SnapshotQueue::~SnapshotQueue(){ }
+
+/**
+ * SnapshotQueue::push(snapshot)
+ *
+ * Add a snapshot to the back of the queue, applying the drop policy if the queue is full.
+ * Snapshots pushed after the queue is closed are ignored.
+ *
+ * @param snapshot
+ *      The snapshot, moved into the queue.
+ */
+
+void SnapshotQueue::push(Snapshot snapshot){
+  {
+    std::unique_lock<std::mutex> guard(this->lock);
+    if (this->policy==DropPolicy::BLOCK){
+      this->notFull.wait(guard, [&](){ return this->closed || this->snapshots.size()<this->capacity; });
+    }
+    else if (this->snapshots.size()>=this->capacity){
+      this->snapshots.pop_front();
+      this->dropped++;
+    }
+    if (this->closed){
+      return;
+    }
+    this->snapshots.push_back(std::move(snapshot));
+  }
+  this->notEmpty.notify_one();
+}
+
+/**
+ * SnapshotQueue::pop(snapshot)
+ *
+ * Take the snapshot at the front of the queue, waiting for one to be pushed if the queue is empty.
+ *
+ * @param snapshot
+ *      Set to the snapshot taken.
+ *
+ * @return
+ *      True if a snapshot was taken, false if the queue is closed and empty.
+ */
+
+bool SnapshotQueue::pop(Snapshot& snapshot){
+  {
+    std::unique_lock<std::mutex> guard(this->lock);
+    this->notEmpty.wait(guard, [&](){ return this->closed || !this->snapshots.empty(); });
+    if (this->snapshots.empty()){
+      return false;
+    }
+    snapshot=std::move(this->snapshots.front());
+    this->snapshots.pop_front();
+  }
+  this->notFull.notify_one();
+  return true;
+}
+
+/**
+ * SnapshotQueue::close()
+ *
+ * Close the queue. Snapshots already waiting can still be popped, after which SnapshotQueue::pop returns false.
+ */
+
+void SnapshotQueue::close(){
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->closed=true;
+  }
+  this->notEmpty.notify_all();
+  this->notFull.notify_all();
+}
+
+/**
+ * SnapshotQueue::get_dropped()
+ *
+ * Gets the number of snapshots thrown away by DropPolicy::SKIP_STALE.
+ *
+ * @return
+ *      The number of dropped snapshots.
+ */
+
+long SnapshotQueue::get_dropped(){
+  std::lock_guard<std::mutex> guard(this->lock);
+  return this->dropped;
+}
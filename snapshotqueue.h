@@ -0,0 +1,55 @@
+/**
+ * Declares a class representing a bounded queue of world snapshots passed from a simulation thread to an output thread.
+ * Rich documentation for the api and behaviour the SnapshotQueue class can be found in snapshotqueue.cpp.
+ */
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include "grid.h"
+
+/**
+ * A DropPolicy selects what SnapshotQueue::push does when the queue is full.
+ *      - DropPolicy::BLOCK waits for the output thread to take a snapshot, so every snapshot is written.
+ *      - DropPolicy::SKIP_STALE throws away the oldest waiting snapshot, so the simulation never waits.
+ */
+enum DropPolicy {
+    BLOCK,
+    SKIP_STALE
+};
+
+/**
+ * A Snapshot is an immutable copy of the state of a world after a given step.
+ * Its Grid shares the cells of the world rather than copying them, as the world never writes them again.
+ */
+struct Snapshot {
+    int step;
+    Grid state;
+};
+
+/**
+ * Declare the structure of the SnapshotQueue class for handing snapshots between one producer and one consumer.
+ */
+class SnapshotQueue {
+  private:
+    size_t capacity;
+    DropPolicy policy;
+    std::deque<Snapshot> snapshots;
+    std::mutex lock;
+    std::condition_variable notEmpty;
+    std::condition_variable notFull;
+    bool closed;
+    long dropped;
+
+  public:
+    SnapshotQueue(size_t capacity, DropPolicy policy);
+    SnapshotQueue(const SnapshotQueue&) = delete;
+    SnapshotQueue& operator=(const SnapshotQueue&) = delete;
+    ~SnapshotQueue();
+
+    void push(Snapshot snapshot);
+    bool pop(Snapshot& snapshot);
+    void close();
+    long get_dropped();
+};
@@ -0,0 +1,509 @@
+/**
+ * Implements a class representing an unbounded 2d world stored as the set of its alive cells.
+ *      - The plane has no edges, so spaceships fly forever instead of dying or wrapping at a border.
+ *      - Alive cells are stored by their 64-bit coordinates in an open-addressing hash table.
+ *          - Memory is proportional to the population, not to the bounding box of the pattern.
+ *          - Tables grow when half full and shrink when under an eighth full, so a population that booms and
+ *            then dies back does not leave every later step scanning the slots of the boom.
+ *
+ *      - Stepping the world applies the rules of Conway's Game of Life, or any other Rule without B0.
+ *          - Every alive cell adds one to the neighbour count of the eight cells around it in a second table.
+ *          - Only cells with a count, or that are alive, can be alive in the next generation.
+ *
+ *      - Any rectangular window of the plane can be copied out to a Grid.
+ */
+#include <algorithm>
+#include <stdexcept>
+#include "sparseworld.h"
+
+// The value bit marking a counted cell as alive, below it is the count of alive neighbours
+static const uint8_t ALIVE_FLAG=16;
+
+/**
+ * SparseWorld::CellTable::CellTable()
+ *
+ * Construct an empty table.
+ */
+
+SparseWorld::CellTable::CellTable():count(0){
+  this->slots.resize(MIN_SLOTS, Slot{0, 0, 0, false});
+}
+
+/**
+ * SparseWorld::CellTable::size()
+ *
+ * Gets the number of coordinates stored in the table.
+ *
+ * @return
+ *      The number of used slots.
+ */
+
+size_t SparseWorld::CellTable::size() const{
+  return this->count;
+}
+
+/**
+ * SparseWorld::CellTable::get_slots()
+ *
+ * Gets every slot of the table, used or not, for iterating over the stored coordinates.
+ *
+ * @return
+ *      The slots of the table.
+ */
+
+const std::vector<SparseWorld::CellTable::Slot>& SparseWorld::CellTable::get_slots() const{
+  return this->slots;
+}
+
+/**
+ * SparseWorld::CellTable::home(x, y)
+ *
+ * Private helper function to hash a coordinate to the slot where probing for it starts.
+ *
+ * @return
+ *      The index of the first slot to probe.
+ */
+
+size_t SparseWorld::CellTable::home(int64_t x, int64_t y) const{
+  uint64_t h=(uint64_t)x*0x9E3779B97F4A7C15ULL^(uint64_t)y*0xC2B2AE3D27D4EB4FULL;
+  h^=h>>29;
+  h*=0xBF58476D1CE4E5B9ULL;
+  h^=h>>32;
+  return h&(this->slots.size()-1);
+}
+
+/**
+ * SparseWorld::CellTable::find(x, y)
+ *
+ * Looks up a coordinate.
+ *
+ * @return
+ *      The slot holding the coordinate, or nullptr if it is not in the table.
+ */
+
+const SparseWorld::CellTable::Slot* SparseWorld::CellTable::find(int64_t x, int64_t y) const{
+  size_t mask=this->slots.size()-1;
+  for (size_t i=this->home(x, y); this->slots[i].used; i=(i+1)&mask){
+    if (this->slots[i].x==x && this->slots[i].y==y){
+      return &this->slots[i];
+    }
+  }
+  return nullptr;
+}
+
+/**
+ * SparseWorld::CellTable::add(x, y, value)
+ *
+ * Adds to the value stored for a coordinate, inserting the coordinate with the value if it is not in the table.
+ * The table doubles in size whenever it becomes half full.
+ *
+ * @param x, y
+ *      The coordinate.
+ *
+ * @param value
+ *      The amount to add.
+ */
+
+void SparseWorld::CellTable::add(int64_t x, int64_t y, uint8_t value){
+  if ((this->count+1)*2>this->slots.size()){
+    this->rehash(this->slots.size()*2);
+  }
+  size_t mask=this->slots.size()-1;
+  size_t i=this->home(x, y);
+  while (this->slots[i].used){
+    if (this->slots[i].x==x && this->slots[i].y==y){
+      this->slots[i].value+=value;
+      return;
+    }
+    i=(i+1)&mask;
+  }
+  this->slots[i]=Slot{x, y, value, true};
+  this->count++;
+}
+
+/**
+ * SparseWorld::CellTable::erase(x, y)
+ *
+ * Removes a coordinate from the table. The following slots of the probe run are shifted back,
+ * so no tombstones are left behind. The table halves in size whenever it falls under an eighth full.
+ *
+ * @param x, y
+ *      The coordinate.
+ *
+ * @return
+ *      True if the coordinate was in the table.
+ */
+
+bool SparseWorld::CellTable::erase(int64_t x, int64_t y){
+  size_t mask=this->slots.size()-1;
+  size_t i=this->home(x, y);
+  while (this->slots[i].used && !(this->slots[i].x==x && this->slots[i].y==y)){
+    i=(i+1)&mask;
+  }
+  if (!this->slots[i].used){
+    return false;
+  }
+  size_t hole=i;
+  for (size_t j=(hole+1)&mask; this->slots[j].used; j=(j+1)&mask){
+    //Move the slot back if the hole lies between its home and where it is now
+    size_t want=this->home(this->slots[j].x, this->slots[j].y);
+    if (((j-want)&mask)>=((j-hole)&mask)){
+      this->slots[hole]=this->slots[j];
+      hole=j;
+    }
+  }
+  this->slots[hole].used=false;
+  this->count--;
+  if (this->slots.size()>MIN_SLOTS && this->count*8<this->slots.size()){
+    this->rehash(this->slots.size()/2);
+  }
+  return true;
+}
+
+/**
+ * SparseWorld::CellTable::clear()
+ *
+ * Removes every coordinate. A table is cleared to be refilled with about as many coordinates as it held, so its
+ * capacity is kept for reuse, unless it was under an eighth full. It then shrinks to a quarter full for the
+ * coordinates it held, so refilling it does not scan a mostly empty table, and has room to grow before it rehashes.
+ */
+
+void SparseWorld::CellTable::clear(){
+  size_t fitted=this->fitted_slots();
+  if (fitted<this->slots.size() && this->count*8<this->slots.size()){
+    this->slots.assign(fitted, Slot{0, 0, 0, false});
+  }
+  else{
+    for (Slot& slot : this->slots){
+      slot.used=false;
+    }
+  }
+  this->count=0;
+}
+
+/**
+ * SparseWorld::CellTable::fitted_slots()
+ *
+ * Private helper function to find the number of slots leaving the table a quarter full, the smallest power of two
+ * at least four times the number of stored coordinates, and at least the size of a new table.
+ *
+ * @return
+ *      The number of slots.
+ */
+
+size_t SparseWorld::CellTable::fitted_slots() const{
+  size_t fitted=MIN_SLOTS;
+  while (fitted<this->count*4){
+    fitted*=2;
+  }
+  return fitted;
+}
+
+/**
+ * SparseWorld::CellTable::rehash(slots)
+ *
+ * Private helper function to resize the table to a new number of slots and reinsert every stored coordinate.
+ *
+ * @param slots
+ *      The new number of slots, a power of two more than twice the number of stored coordinates.
+ */
+
+void SparseWorld::CellTable::rehash(size_t slots){
+  std::vector<Slot> old;
+  old.swap(this->slots);
+  this->slots.assign(slots, Slot{0, 0, 0, false});
+  this->count=0;
+  for (const Slot& slot : old){
+    if (slot.used){
+      this->add(slot.x, slot.y, slot.value);
+    }
+  }
+}
+
+/**
+ * SparseWorld::SparseWorld()
+ *
+ * Construct an empty plane at generation 0.
+ *
+ * @example
+ *
+ *      // Make an empty plane
+ *      SparseWorld world;
+ *
+ */
+
+SparseWorld::SparseWorld():generation(0){}
+
+/**
+ * SparseWorld::SparseWorld(grid)
+ *
+ * Construct a plane at generation 0 holding the alive cells of a Grid, with the top left of the grid at (0, 0).
+ *
+ * @example
+ *
+ *      // Launch a light weight spaceship onto an unbounded plane
+ *      SparseWorld world(Zoo::light_weight_spaceship());
+ *
+ * @param grid
+ *      The cells to place on the plane.
+ */
+
+SparseWorld::SparseWorld(const Grid& grid):generation(0){
+  this->merge(grid, 0, 0);
+}
+
+SparseWorld::~SparseWorld(){ }
+
+/**
+ * SparseWorld::get_alive_cells()
+ *
+ * Counts how many cells on the plane are alive.
+ *
+ * @return
+ *      The number of alive cells.
+ */
+
+long long SparseWorld::get_alive_cells() const{
+  return this->alive.size();
+}
+
+/**
+ * SparseWorld::get_generation()
+ *
+ * Gets the number of steps taken since the plane was constructed.
+ *
+ * @return
+ *      The current generation.
+ */
+
+long long SparseWorld::get_generation() const{
+  return this->generation;
+}
+
+/**
+ * SparseWorld::get_rule()
+ *
+ * Gets the rule the plane is stepped with.
+ *
+ * @return
+ *      The current rule.
+ */
+
+Rule SparseWorld::get_rule() const{
+  return this->rule;
+}
+
+/**
+ * SparseWorld::set_rule(rule)
+ *
+ * Change the rule the plane is stepped with from the next step onwards.
+ *
+ * @param rule
+ *      The new rule.
+ *
+ * @throws
+ *      std::runtime_error if the rule gives birth with 0 neighbours, which would fill the whole plane.
+ */
+
+void SparseWorld::set_rule(const Rule& rule){
+  if (rule.next(false, 0)){
+    throw std::runtime_error("SparseWorld cannot run rules with B0 on an unbounded plane");
+  }
+  this->rule=rule;
+}
+
+/**
+ * SparseWorld::get(x, y)
+ *
+ * Returns the value of the cell at the desired coordinate. Every coordinate is valid.
+ *
+ * @param x, y
+ *      The coordinate of the cell.
+ *
+ * @return
+ *      The value of the cell.
+ */
+
+Cell SparseWorld::get(int64_t x, int64_t y) const{
+  if (this->alive.find(x, y)!=nullptr){
+    return Cell::ALIVE;
+  }
+  return Cell::DEAD;
+}
+
+/**
+ * SparseWorld::set(x, y, value)
+ *
+ * Overwrites the value at the desired coordinate. Every coordinate is valid.
+ *
+ * @param x, y
+ *      The coordinate of the cell.
+ *
+ * @param value
+ *      The value to be written to the cell.
+ */
+
+void SparseWorld::set(int64_t x, int64_t y, Cell c){
+  if (c==Cell::ALIVE){
+    if (this->alive.find(x, y)==nullptr){
+      this->alive.add(x, y, 1);
+    }
+  }
+  else{
+    this->alive.erase(x, y);
+  }
+}
+
+/**
+ * SparseWorld::merge(grid, x0, y0)
+ *
+ * Overlay the alive cells of a Grid on the plane with the top left of the grid at x0,y0.
+ * Dead cells of the grid leave the plane unchanged.
+ *
+ * @example
+ *
+ *      // Place a glider far from the origin
+ *      world.merge(Zoo::glider(), 1000000000000, -5);
+ *
+ * @param grid
+ *      The grid to place.
+ *
+ * @param x0, y0
+ *      The coordinate of the top left corner of the grid on the plane.
+ */
+
+void SparseWorld::merge(const Grid& grid, int64_t x0, int64_t y0){
+  for (int y=0; y<grid.get_height(); y++){
+    const Cell* cells=grid.row(y);
+    for (int x=0; x<grid.get_width(); x++){
+      if (cells[x]==Cell::ALIVE){
+        this->set(x0+x, y0+y, Cell::ALIVE);
+      }
+    }
+  }
+}
+
+/**
+ * SparseWorld::get_bounds(x0, y0, x1, y1)
+ *
+ * Gets the bounding box of the alive cells, spanning [x0, x1) by [y0, y1).
+ *
+ * @example
+ *
+ *      // Copy the whole pattern out to a grid
+ *      int64_t x0, y0, x1, y1;
+ *      if (world.get_bounds(x0, y0, x1, y1)) {
+ *          Grid grid = world.to_grid(x0, y0, x1 - x0, y1 - y0);
+ *      }
+ *
+ * @return
+ *      False, leaving the parameters unchanged, if there are no alive cells.
+ */
+
+bool SparseWorld::get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) const{
+  bool found=false;
+  for (const CellTable::Slot& slot : this->alive.get_slots()){
+    if (!slot.used){
+      continue;
+    }
+    if (!found){
+      x0=slot.x;
+      y0=slot.y;
+      x1=slot.x+1;
+      y1=slot.y+1;
+      found=true;
+    }
+    x0=std::min(x0, slot.x);
+    y0=std::min(y0, slot.y);
+    x1=std::max(x1, slot.x+1);
+    y1=std::max(y1, slot.y+1);
+  }
+  return found;
+}
+
+/**
+ * SparseWorld::to_grid(x0, y0, width, height)
+ *
+ * Copy a window of the plane into a Grid. Runs in time proportional to the population.
+ *
+ * @example
+ *
+ *      // Print the 32x32 cells to the right of and below the origin
+ *      std::cout << world.to_grid(0, 0, 32, 32) << std::endl;
+ *
+ * @param x0, y0
+ *      The coordinate of the top left corner of the window.
+ *
+ * @param width, height
+ *      The size of the window.
+ *
+ * @return
+ *      A Grid holding the cells of the window.
+ */
+
+Grid SparseWorld::to_grid(int64_t x0, int64_t y0, int width, int height) const{
+  Grid result(width, height);
+  int alive=0;
+  for (const CellTable::Slot& slot : this->alive.get_slots()){
+    if (slot.used && slot.x>=x0 && slot.y>=y0 && slot.x-x0<width && slot.y-y0<height){
+      result.row_data(slot.y-y0, BulkKey())[slot.x-x0]=Cell::ALIVE;
+      alive++;
+    }
+  }
+  result.set_alive_cells(alive, BulkKey());
+  return result;
+}
+
+/**
+ * SparseWorld::step()
+ *
+ * Take one step of the rule on the unbounded plane.
+ *
+ * Every alive cell adds one to the count of each of its eight neighbours, and marks itself alive, in the
+ * count table. The cells of the count table are then the only ones that can be alive in the next generation.
+ */
+
+void SparseWorld::step(){
+  this->counts.clear();
+  for (const CellTable::Slot& slot : this->alive.get_slots()){
+    if (!slot.used){
+      continue;
+    }
+    this->counts.add(slot.x, slot.y, ALIVE_FLAG);
+    for (int dy=-1; dy<=1; dy++){
+      for (int dx=-1; dx<=1; dx++){
+        if (dx!=0 || dy!=0){
+          this->counts.add(slot.x+dx, slot.y+dy, 1);
+        }
+      }
+    }
+  }
+  this->alive.clear();
+  for (const CellTable::Slot& slot : this->counts.get_slots()){
+    if (!slot.used){
+      continue;
+    }
+    int count=slot.value&(ALIVE_FLAG-1);
+    bool self=(slot.value&ALIVE_FLAG)!=0;
+    if (this->rule.next(self, count)){
+      this->alive.add(slot.x, slot.y, 1);
+    }
+  }
+  this->generation++;
+}
+
+/**
+ * SparseWorld::advance(steps)
+ *
+ * Advance multiple steps in the Game of Life.
+ * Implemented by invoking SparseWorld::step().
+ *
+ * @param steps
+ *      The number of steps to advance the world forward.
+ */
+
+void SparseWorld::advance(int steps){
+  for (int i=0; i<steps; i++){
+    this->step();
+  }
+}
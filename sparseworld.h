@@ -0,0 +1,71 @@
+/**
+ * Declares a class representing an unbounded 2d world stored as the set of its alive cells.
+ * Rich documentation for the api and behaviour the SparseWorld class can be found in sparseworld.cpp.
+ */
+#pragma once
+#include <vector>
+#include <cstdint>
+#include "grid.h"
+#include "rule.h"
+
+/**
+ * Declare the structure of the SparseWorld class for simulating the Game of Life on an unbounded plane.
+ *
+ * Only alive cells are stored, keyed on their 64-bit x,y coordinates in an open-addressing hash table,
+ * so memory is proportional to the population and not to the area the pattern has spread over.
+ */
+class SparseWorld {
+  private:
+    /**
+     * An open-addressing hash table with linear probing, mapping a 64-bit x,y coordinate to a small value.
+     */
+    class CellTable {
+      public:
+        struct Slot {
+            int64_t x;
+            int64_t y;
+            uint8_t value;
+            bool used;
+        };
+
+        CellTable();
+        size_t size() const;
+        const std::vector<Slot>& get_slots() const;
+        const Slot* find(int64_t x, int64_t y) const;
+        void add(int64_t x, int64_t y, uint8_t value);
+        bool erase(int64_t x, int64_t y);
+        void clear();
+
+      private:
+        static const size_t MIN_SLOTS=16;
+
+        std::vector<Slot> slots;
+        size_t count;
+
+        size_t home(int64_t x, int64_t y) const;
+        size_t fitted_slots() const;
+        void rehash(size_t slots);
+    };
+
+    CellTable alive;
+    CellTable counts;
+    long long generation;
+    Rule rule;
+
+  public:
+    SparseWorld();
+    explicit SparseWorld(const Grid& grid);
+    ~SparseWorld();
+
+    long long get_alive_cells() const;
+    long long get_generation() const;
+    Rule get_rule() const;
+    void set_rule(const Rule& rule);
+    Cell get(int64_t x, int64_t y) const;
+    void set(int64_t x, int64_t y, Cell c);
+    void merge(const Grid& grid, int64_t x0, int64_t y0);
+    bool get_bounds(int64_t& x0, int64_t& y0, int64_t& x1, int64_t& y1) const;
+    Grid to_grid(int64_t x0, int64_t y0, int width, int height) const;
+    void step();
+    void advance(int steps);
+};
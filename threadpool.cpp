@@ -0,0 +1,289 @@
+/**
+ * Implements a class representing a persistent pool of worker threads.
+ *      - The worker threads are started once when the pool is constructed and joined when it is destroyed.
+ *      - ThreadPool::run hands a numbered set of tasks to the workers and waits for them all to finish.
+ *          - The tasks are a std::function, or a plain function pointer and a context pointer to pass it. The
+ *            plain function never allocates, whatever the task needs, so it suits work run every generation.
+ *      - Tasks are assigned statically, task i always running on thread i % get_threads(),
+ *        so the same task number keeps landing on the same thread from one run to the next.
+ *      - A pinned pool pins each worker to its own core, taking the cores the process may run on in order of
+ *        their NUMA node, so neighbouring tasks share a node. The calling thread is left free and runs no tasks.
+ */
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <string>
+#include <utility>
+#include <pthread.h>
+#include <sched.h>
+#include "threadpool.h"
+
+/**
+ * node_of_cpu(cpu)
+ *
+ * Finds the NUMA node of a core from the nodeN entry in its sysfs directory.
+ *
+ * @param cpu
+ *      The number of the core.
+ *
+ * @return
+ *      The node of the core, or 0 if the system does not say.
+ */
+
+static int node_of_cpu(int cpu){
+  std::error_code error;
+  for (const auto& entry : std::filesystem::directory_iterator("/sys/devices/system/cpu/cpu"+std::to_string(cpu), error)){
+    std::string name=entry.path().filename().string();
+    if (name.size()>4 && name.compare(0, 4, "node")==0 && std::isdigit((unsigned char)name[4])){
+      return std::stoi(name.substr(4));
+    }
+  }
+  return 0;
+}
+
+/**
+ * cpus_by_node()
+ *
+ * Lists the cores the process may run on, grouped by NUMA node, and by number within a node.
+ *
+ * @return
+ *      The cores, or nothing if the affinity of the process cannot be read.
+ */
+
+static std::vector<int> cpus_by_node(){
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed)!=0){
+    return {};
+  }
+  std::vector<std::pair<int, int>> nodes;
+  for (int cpu=0; cpu<CPU_SETSIZE; cpu++){
+    if (CPU_ISSET(cpu, &allowed)){
+      nodes.push_back({node_of_cpu(cpu), cpu});
+    }
+  }
+  std::sort(nodes.begin(), nodes.end());
+  std::vector<int> cpus;
+  for (const auto& node : nodes){
+    cpus.push_back(node.second);
+  }
+  return cpus;
+}
+
+/**
+ * ThreadPool::ThreadPool(threads)
+ *
+ * Construct a pool running tasks on the given number of threads, including the caller of ThreadPool::run.
+ * A pool of 1 thread starts no workers and runs every task on the calling thread.
+ *
+ * @example
+ *
+ *      // Make a pool using every core
+ *      ThreadPool pool(std::thread::hardware_concurrency());
+ *
+ * @param threads
+ *      The number of threads to run tasks on. Values below 1 are treated as 1.
+ */
+
+ThreadPool::ThreadPool(int threads):ThreadPool(threads, false){ }
+
+/**
+ * ThreadPool::ThreadPool(threads, pinned)
+ *
+ * Construct a pool running tasks on the given number of threads, optionally pinned to cores.
+ * A pinned pool starts one worker per thread, worker i pinned to the i-th core in order of NUMA node,
+ * wrapping around if there are more threads than cores. A worker which cannot be pinned runs unpinned.
+ * Memory first written by a pinned worker is placed on its node, and stays there, as the worker never moves.
+ *
+ * @example
+ *
+ *      // Make a pool of 16 threads, each pinned to its own core
+ *      ThreadPool pool(16, true);
+ *
+ * @param threads
+ *      The number of threads to run tasks on. Values below 1 are treated as 1.
+ *
+ * @param pinned
+ *      If true every task runs on a pinned worker, otherwise thread 0 is the caller of ThreadPool::run.
+ */
+
+ThreadPool::ThreadPool(int threads, bool pinned):threads(threads), pinned(pinned), task(nullptr), context(nullptr), tasks(0),
+pending(0), generation(0), stopping(false){
+  if (this->threads<1){
+    this->threads=1;
+  }
+  if (this->pinned){
+    this->cpus=cpus_by_node();
+  }
+  for (int id=(this->pinned ? 0 : 1); id<this->threads; id++){
+    this->workers.emplace_back(&ThreadPool::work, this, id);
+    int cpu=this->get_cpu(id);
+    if (cpu>=0){
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(cpu, &set);
+      pthread_setaffinity_np(this->workers.back().native_handle(), sizeof(set), &set);
+    }
+  }
+}
+
+/**
+ * ThreadPool::~ThreadPool()
+ *
+ * Stop and join every worker thread.
+ */
+
+ThreadPool::~ThreadPool(){
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->stopping=true;
+  }
+  this->wake.notify_all();
+  for (std::thread& worker : this->workers){
+    worker.join();
+  }
+}
+
+/**
+ * ThreadPool::get_threads()
+ *
+ * Gets the number of threads tasks are run on.
+ *
+ * @return
+ *      The number of threads, including the caller of ThreadPool::run.
+ */
+
+int ThreadPool::get_threads() const{
+  return this->threads;
+}
+
+/**
+ * ThreadPool::get_pinned()
+ *
+ * Gets whether every task runs on a worker pinned to a core.
+ *
+ * @return
+ *      True if the pool is pinned.
+ */
+
+bool ThreadPool::get_pinned() const{
+  return this->pinned;
+}
+
+/**
+ * ThreadPool::get_cpu(thread)
+ *
+ * Gets the core a thread of a pinned pool is pinned to.
+ *
+ * @param thread
+ *      The number of the thread, from 0 to get_threads() - 1.
+ *
+ * @return
+ *      The core, or -1 if the pool is not pinned or the cores could not be listed.
+ */
+
+int ThreadPool::get_cpu(int thread) const{
+  if (!this->pinned || this->cpus.empty()){
+    return -1;
+  }
+  return this->cpus[thread%this->cpus.size()];
+}
+
+/**
+ * ThreadPool::work(id)
+ *
+ * Private helper function run by each worker thread. Waits for ThreadPool::run to publish a new set of tasks,
+ * runs the tasks numbered id, id + threads, id + 2 * threads, ... and reports back when finished.
+ *
+ * @param id
+ *      The number of this worker thread, from 1 to threads - 1, or from 0 in a pinned pool.
+ */
+
+void ThreadPool::work(int id){
+  long seen=0;
+  std::unique_lock<std::mutex> guard(this->lock);
+  while (true){
+    this->wake.wait(guard, [&](){ return this->stopping || this->generation!=seen; });
+    if (this->stopping){
+      return;
+    }
+    seen=this->generation;
+    void (*current)(void*, int)=this->task;
+    void* context=this->context;
+    int count=this->tasks;
+    guard.unlock();
+    for (int i=id; i<count; i+=this->threads){
+      current(context, i);
+    }
+    guard.lock();
+    this->pending--;
+    if (this->pending==0){
+      this->done.notify_one();
+    }
+  }
+}
+
+/**
+ * ThreadPool::run(tasks, task)
+ *
+ * Run task(0) to task(tasks - 1) across the pool and wait for all of them to finish.
+ * Task i runs on thread i % get_threads(), thread 0 being the calling thread unless the pool is pinned.
+ * Calls from several threads at once are run one after another.
+ *
+ * @example
+ *
+ *      // Fill 8 bands of a vector in parallel
+ *      pool.run(8, [&](int band){ fill_band(band); });
+ *
+ * @param tasks
+ *      The number of tasks to run.
+ *
+ * @param task
+ *      The function to call with each task number.
+ */
+
+void ThreadPool::run(int tasks, const std::function<void(int)>& task){
+  this->run(tasks, [](void* context, int index){ (*(const std::function<void(int)>*)context)(index); }, (void*)&task);
+}
+
+/**
+ * ThreadPool::run(tasks, task, context)
+ *
+ * Run task(context, 0) to task(context, tasks - 1) across the pool and wait for all of them to finish,
+ * on the same threads as ThreadPool::run(tasks, task). Nothing is allocated, however much state the task needs.
+ *
+ * @example
+ *
+ *      // Fill 8 bands of a vector in parallel, the lambda capturing nothing so it converts to a function pointer
+ *      struct Job { std::vector<int>* cells; int bands; } job={&cells, 8};
+ *      pool.run(8, [](void* context, int band){ fill_band(*(Job*)context, band); }, &job);
+ *
+ * @param tasks
+ *      The number of tasks to run.
+ *
+ * @param task
+ *      The function to call with the context and each task number.
+ *
+ * @param context
+ *      The pointer passed to every call of the task.
+ */
+
+void ThreadPool::run(int tasks, void (*task)(void* context, int index), void* context){
+  std::lock_guard<std::mutex> running(this->run_lock);
+  {
+    std::lock_guard<std::mutex> guard(this->lock);
+    this->task=task;
+    this->context=context;
+    this->tasks=tasks;
+    this->pending=this->workers.size();
+    this->generation++;
+  }
+  this->wake.notify_all();
+  if (!this->pinned){
+    for (int i=0; i<tasks; i+=this->threads){
+      task(context, i);
+    }
+  }
+  std::unique_lock<std::mutex> guard(this->lock);
+  this->done.wait(guard, [&](){ return this->pending==0; });
+}
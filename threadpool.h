@@ -0,0 +1,49 @@
+/**
+ * Declares a class representing a persistent pool of worker threads.
+ * Rich documentation for the api and behaviour the ThreadPool class can be found in threadpool.cpp.
+ */
+#pragma once
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+/**
+ * Declare the structure of the ThreadPool class for running numbered tasks on a fixed set of threads.
+ *
+ * Task i always runs on thread i % get_threads(), where thread 0 is the thread calling ThreadPool::run.
+ * A pinned pool instead runs every task on a worker pinned to one core, so thread 0 is a worker too.
+ */
+class ThreadPool {
+  private:
+    int threads;
+    bool pinned;
+    std::vector<std::thread> workers;
+    std::vector<int> cpus;
+    std::mutex lock;
+    std::mutex run_lock;
+    std::condition_variable wake;
+    std::condition_variable done;
+    void (*task)(void* context, int index);
+    void* context;
+    int tasks;
+    int pending;
+    long generation;
+    bool stopping;
+
+    void work(int id);
+
+  public:
+    explicit ThreadPool(int threads);
+    ThreadPool(int threads, bool pinned);
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+    ~ThreadPool();
+
+    int get_threads() const;
+    bool get_pinned() const;
+    int get_cpu(int thread) const;
+    void run(int tasks, const std::function<void(int)>& task);
+    void run(int tasks, void (*task)(void* context, int index), void* context);
+};
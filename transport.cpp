@@ -0,0 +1,318 @@
+/**
+ * Implements the transports worker processes of a DistributedWorld exchange their halo rows over.
+ *      - A Transport connects a ring of ranks, each able to send to the rank above and the rank below it.
+ *      - Transports are created by the parent process before forking, and each worker then attaches as its rank.
+ *      - Every channel holds at most one message at a time, so a sender waits until its last message was received.
+ *
+ *      - SocketTransport passes messages over one Unix domain socket pair per channel.
+ *      - SharedMemoryTransport copies messages through one buffer per channel in an anonymous shared mapping,
+ *        handing each buffer between the processes with two process-shared semaphores.
+ */
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "transport.h"
+
+Transport::~Transport(){ }
+
+/**
+ * SocketTransport::SocketTransport(ranks, capacity)
+ *
+ * Construct a transport of one socket pair per channel. The socket buffers are asked to hold a whole message, so a
+ * sender rarely waits on its receiver, but the kernel caps them at net.core.wmem_max and net.core.rmem_max, so
+ * a long row may still only be sent as it is received. DistributedWorld orders its exchanges so that never deadlocks.
+ *
+ * @example
+ *
+ *      // Connect 4 workers exchanging rows of 1000 cells
+ *      SocketTransport transport(4, 1000);
+ *
+ * @param ranks
+ *      The number of ranks in the ring.
+ *
+ * @param capacity
+ *      The largest message in bytes.
+ *
+ * @throws
+ *      std::runtime_error if the sockets cannot be created.
+ */
+
+SocketTransport::SocketTransport(int ranks, size_t capacity):ranks(ranks), capacity(capacity){
+  for (int c=0; c<2*ranks; c++){
+    int ends[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, ends)!=0){
+      throw std::runtime_error("Could not create a socket pair: "+std::string(std::strerror(errno)));
+    }
+    //Only a hint, so a buffer the kernel caps or refuses is not an error
+    int buffer=(int)std::min(2*capacity+4096, (size_t)std::numeric_limits<int>::max());
+    setsockopt(ends[0], SOL_SOCKET, SO_SNDBUF, &buffer, sizeof(buffer));
+    setsockopt(ends[1], SOL_SOCKET, SO_RCVBUF, &buffer, sizeof(buffer));
+    this->writeEnds.push_back(ends[0]);
+    this->readEnds.push_back(ends[1]);
+  }
+}
+
+SocketTransport::~SocketTransport(){
+  for (int fd : this->writeEnds){
+    if (fd>=0){
+      close(fd);
+    }
+  }
+  for (int fd : this->readEnds){
+    if (fd>=0){
+      close(fd);
+    }
+  }
+}
+
+int SocketTransport::get_ranks() const{
+  return this->ranks;
+}
+
+size_t SocketTransport::get_capacity() const{
+  return this->capacity;
+}
+
+/**
+ * SocketTransport::attach(rank)
+ *
+ * Called in a worker process to close every socket the rank does not use, keeping the write ends of its own
+ * two channels and the read ends of the channels its neighbours send to it on.
+ *
+ * @param rank
+ *      The rank of the worker.
+ */
+
+void SocketTransport::attach(int rank){
+  int up=(rank+this->ranks-1)%this->ranks;
+  int down=(rank+1)%this->ranks;
+  for (int c=0; c<2*this->ranks; c++){
+    bool writes=(c==rank*2+UP || c==rank*2+DOWN);
+    bool reads=(c==up*2+DOWN || c==down*2+UP);
+    if (!writes){
+      close(this->writeEnds[c]);
+      this->writeEnds[c]=-1;
+    }
+    if (!reads){
+      close(this->readEnds[c]);
+      this->readEnds[c]=-1;
+    }
+  }
+}
+
+/**
+ * SocketTransport::send(rank, direction, data, bytes)
+ *
+ * Send a message from a rank along one of its channels.
+ *
+ * @param rank
+ *      The sending rank.
+ *
+ * @param direction
+ *      Transport::UP or Transport::DOWN.
+ *
+ * @param data
+ *      The message.
+ *
+ * @param bytes
+ *      The length of the message, at most get_capacity().
+ *
+ * @throws
+ *      std::runtime_error if the message is larger than get_capacity() or could not be written.
+ */
+
+void SocketTransport::send(int rank, int direction, const void* data, size_t bytes){
+  if (bytes>this->capacity){
+    throw std::runtime_error("The message is larger than the capacity of the transport");
+  }
+  int fd=this->writeEnds[rank*2+direction];
+  const char* next=(const char*)data;
+  while (bytes>0){
+    ssize_t written=::send(fd, next, bytes, MSG_NOSIGNAL);
+    if (written<0 && errno==EINTR){
+      continue;
+    }
+    if (written<=0){
+      throw std::runtime_error("Could not send a halo: "+std::string(std::strerror(errno)));
+    }
+    next+=written;
+    bytes-=written;
+  }
+}
+
+/**
+ * SocketTransport::receive(rank, direction, data, bytes)
+ *
+ * Receive the message a rank sent along one of its channels, waiting until it arrives.
+ *
+ * @param rank
+ *      The sending rank.
+ *
+ * @param direction
+ *      The channel of the sending rank, Transport::UP or Transport::DOWN.
+ *
+ * @param data
+ *      Filled with the message.
+ *
+ * @param bytes
+ *      The length of the message.
+ *
+ * @throws
+ *      std::runtime_error if the message could not be read.
+ */
+
+void SocketTransport::receive(int rank, int direction, void* data, size_t bytes){
+  int fd=this->readEnds[rank*2+direction];
+  char* next=(char*)data;
+  while (bytes>0){
+    ssize_t got=::recv(fd, next, bytes, 0);
+    if (got<0 && errno==EINTR){
+      continue;
+    }
+    if (got<=0){
+      throw std::runtime_error("Could not receive a halo: "+std::string(std::strerror(errno)));
+    }
+    next+=got;
+    bytes-=got;
+  }
+}
+
+/**
+ * SharedMemoryTransport::SharedMemoryTransport(ranks, capacity)
+ *
+ * Construct a transport of one buffer per channel in an anonymous shared mapping, which forked workers inherit.
+ * Each buffer starts empty, its empty semaphore at 1 and its full semaphore at 0.
+ *
+ * @example
+ *
+ *      // Connect 4 workers exchanging rows of 1000 cells
+ *      SharedMemoryTransport transport(4, 1000);
+ *
+ * @param ranks
+ *      The number of ranks in the ring.
+ *
+ * @param capacity
+ *      The largest message in bytes.
+ *
+ * @throws
+ *      std::runtime_error if the mapping or semaphores cannot be created.
+ */
+
+SharedMemoryTransport::SharedMemoryTransport(int ranks, size_t capacity):ranks(ranks), capacity(capacity){
+  //Keep every channel header aligned for its semaphores
+  this->stride=(sizeof(Channel)+capacity+63)/64*64;
+  this->length=this->stride*2*ranks;
+  this->mapping=mmap(nullptr, this->length, PROT_READ|PROT_WRITE, MAP_SHARED|MAP_ANONYMOUS, -1, 0);
+  if (this->mapping==MAP_FAILED){
+    throw std::runtime_error("Could not map shared memory: "+std::string(std::strerror(errno)));
+  }
+  for (int rank=0; rank<ranks; rank++){
+    for (int direction=UP; direction<=DOWN; direction++){
+      Channel* c=this->channel(rank, direction);
+      if (sem_init(&c->empty, 1, 1)!=0 || sem_init(&c->full, 1, 0)!=0){
+        munmap(this->mapping, this->length);
+        throw std::runtime_error("Could not create a shared semaphore: "+std::string(std::strerror(errno)));
+      }
+    }
+  }
+}
+
+SharedMemoryTransport::~SharedMemoryTransport(){
+  for (int rank=0; rank<this->ranks; rank++){
+    for (int direction=UP; direction<=DOWN; direction++){
+      sem_destroy(&this->channel(rank, direction)->empty);
+      sem_destroy(&this->channel(rank, direction)->full);
+    }
+  }
+  munmap(this->mapping, this->length);
+}
+
+int SharedMemoryTransport::get_ranks() const{
+  return this->ranks;
+}
+
+size_t SharedMemoryTransport::get_capacity() const{
+  return this->capacity;
+}
+
+/**
+ * SharedMemoryTransport::channel(rank, direction)
+ *
+ * Private helper function to find the header of a channel in the mapping. Its buffer follows the header.
+ *
+ * @return
+ *      The channel header.
+ */
+
+SharedMemoryTransport::Channel* SharedMemoryTransport::channel(int rank, int direction) const{
+  return (Channel*)((char*)this->mapping+(rank*2+direction)*this->stride);
+}
+
+/**
+ * SharedMemoryTransport::attach(rank)
+ *
+ * Called in a worker process. Every channel lives in the one inherited mapping, so there is nothing to do.
+ *
+ * @param rank
+ *      The rank of the worker.
+ */
+
+void SharedMemoryTransport::attach(int){ }
+
+/**
+ * wait_for(semaphore)
+ *
+ * Waits on a semaphore, retrying if interrupted by a signal.
+ *
+ * @throws
+ *      std::runtime_error if waiting fails.
+ */
+
+static void wait_for(sem_t* semaphore){
+  while (sem_wait(semaphore)!=0){
+    if (errno!=EINTR){
+      throw std::runtime_error("Could not wait on a shared semaphore: "+std::string(std::strerror(errno)));
+    }
+  }
+}
+
+/**
+ * SharedMemoryTransport::send(rank, direction, data, bytes)
+ *
+ * Send a message from a rank along one of its channels, waiting until the last message on the channel was received.
+ * The parameters match SocketTransport::send.
+ */
+
+void SharedMemoryTransport::send(int rank, int direction, const void* data, size_t bytes){
+  //A longer message would run into the semaphores of the next channel
+  if (bytes>this->capacity){
+    throw std::runtime_error("The message is larger than the capacity of the transport");
+  }
+  Channel* c=this->channel(rank, direction);
+  wait_for(&c->empty);
+  std::memcpy(c+1, data, bytes);
+  sem_post(&c->full);
+}
+
+/**
+ * SharedMemoryTransport::receive(rank, direction, data, bytes)
+ *
+ * Receive the message a rank sent along one of its channels, waiting until it arrives.
+ * The parameters match SocketTransport::receive.
+ */
+
+void SharedMemoryTransport::receive(int rank, int direction, void* data, size_t bytes){
+  if (bytes>this->capacity){
+    throw std::runtime_error("The message is larger than the capacity of the transport");
+  }
+  Channel* c=this->channel(rank, direction);
+  wait_for(&c->full);
+  std::memcpy(data, c+1, bytes);
+  sem_post(&c->empty);
+}
@@ -0,0 +1,83 @@
+/**
+ * Declares the transports worker processes of a DistributedWorld exchange their halo rows over.
+ * Rich documentation for the api and behaviour of the Transport classes can be found in transport.cpp.
+ */
+#pragma once
+#include <cstddef>
+#include <vector>
+#include <semaphore.h>
+
+/**
+ * Declare the interface of a Transport for passing messages between neighbouring ranks in a ring.
+ *
+ * Every rank owns two outgoing channels, Transport::UP towards rank - 1 and Transport::DOWN towards rank + 1,
+ * wrapping around the ends of the ring. Each channel carries one message of at most get_capacity() bytes at a time.
+ * A transport is built before the workers are forked, so every worker inherits the same channels.
+ */
+class Transport {
+  public:
+    static const int UP = 0;
+    static const int DOWN = 1;
+
+    virtual ~Transport();
+    virtual int get_ranks() const = 0;
+    virtual size_t get_capacity() const = 0;
+    virtual void attach(int rank) = 0;
+    virtual void send(int rank, int direction, const void* data, size_t bytes) = 0;
+    virtual void receive(int rank, int direction, void* data, size_t bytes) = 0;
+};
+
+/**
+ * Declare the structure of the SocketTransport class, one Unix domain socket pair per channel.
+ */
+class SocketTransport : public Transport {
+  private:
+    int ranks;
+    size_t capacity;
+    std::vector<int> writeEnds;
+    std::vector<int> readEnds;
+
+  public:
+    SocketTransport(int ranks, size_t capacity);
+    SocketTransport(const SocketTransport&) = delete;
+    SocketTransport& operator=(const SocketTransport&) = delete;
+    ~SocketTransport();
+
+    int get_ranks() const override;
+    size_t get_capacity() const override;
+    void attach(int rank) override;
+    void send(int rank, int direction, const void* data, size_t bytes) override;
+    void receive(int rank, int direction, void* data, size_t bytes) override;
+};
+
+/**
+ * Declare the structure of the SharedMemoryTransport class, one buffer per channel in an anonymous shared mapping,
+ * guarded by a pair of process-shared semaphores.
+ */
+class SharedMemoryTransport : public Transport {
+  private:
+    struct Channel {
+        sem_t empty;
+        sem_t full;
+    };
+
+    int ranks;
+    size_t capacity;
+    size_t stride;
+    size_t length;
+    void* mapping;
+
+    Channel* channel(int rank, int direction) const;
+
+  public:
+    SharedMemoryTransport(int ranks, size_t capacity);
+    SharedMemoryTransport(const SharedMemoryTransport&) = delete;
+    SharedMemoryTransport& operator=(const SharedMemoryTransport&) = delete;
+    ~SharedMemoryTransport();
+
+    int get_ranks() const override;
+    size_t get_capacity() const override;
+    void attach(int rank) override;
+    void send(int rank, int direction, const void* data, size_t bytes) override;
+    void receive(int rank, int direction, void* data, size_t bytes) override;
+};
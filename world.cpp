@@ -7,17 +7,59 @@
  *
  *      - A World holds two equally sized Grid objects for the current state and next state.
  *          - These buffers are swapped after each update step.
+ *          - The buffers persist between steps, so stepping does not allocate any memory.
  *
  *      - Stepping a world forward in time applies the rules of Conway's Game of Life.
  *          - https://en.wikipedia.org/wiki/Conway%27s_Game_of_Life
+ *          - Any other outer-totalistic Rule, such as HighLife B36/S23, can be used instead.
  *
  *      - Worlds have a private helper function used to count the number of alive cells in a 3x3 neighbours
  *        around a given cell.
  *
+ *      - Worlds can advance until they repeat an earlier generation, returning the period of the cycle.
+ *          - Each generation is reduced to a 64-bit hash, and only a bounded history of recent hashes is kept.
+ *          - A matching hash is verified against a saved copy of the world, stepped up to the remembered generation.
+ *
+ *      - Worlds can be checkpointed to a compact bit-packed file mid run, and later restored to carry on from it.
+ *          - The generation number and the topology of the last step are saved with the cells and the rule.
+ *
+ *      - Worlds can keep a history of their recent generations, to be recalled or stepped back to.
+ *          - Generations are stored as sparse XOR deltas between keyframes, within a byte budget.
+ *
+ *      - Worlds can list the cells born and died in each step, so consumers can work in proportion to the changes.
+ *
+ *      - Worlds can be iterated as a lazy sequence of generations with a C++20 coroutine, when the compiler supports them.
+ *
  *      - Updating the world state can conditionally be performed using a toroidal topology.
  *          - Moving off the left edge you appear on the right edge and vice versa.
  *          - Moving off the top edge you appear on the bottom edge and vice versa.
  *
+ *      - Worlds step using a selectable Engine.
+ *          - Engine::NAIVE counts the neighbours of each cell with World::count_neighbours. Its two buffers are
+ *            padded with a one cell halo, refilled before each step, so no cell needs an edge case.
+ *          - Engine::BITWISE stores the world in BitGrid buffers and evaluates 64 cells at a time
+ *            with bitwise full-adder logic. No Grid of a byte per cell is kept alongside them, so the world
+ *            takes 1/8 of the memory, until World::view or World::generations asks for a byte copy to read.
+ *          - Engine::WINDOW (the default) reads the current state rows in place and keeps a sliding
+ *            window of three column sums, so each cell costs a few additions.
+ *          - Engine::PARALLEL splits the rows into one horizontal band per thread and runs the
+ *            Engine::WINDOW kernel on each band using a ThreadPool the world keeps between steps.
+ *            In NUMA mode the threads are pinned to cores, and each band of both buffers is written first by
+ *            the thread stepping it, so its memory sits on that thread's node. The bands never move between
+ *            threads, so the placement holds from one generation to the next.
+ *          - Engine::HASHLIFE keeps the world on an unbounded HashLife plane and advances many
+ *            generations at once. The world is a window onto the plane, so cells that leave the window
+ *            keep evolving rather than dying at the edge, and the toroidal topology is not supported.
+ *          - Engine::TILED splits the world into square tiles and only recomputes the tiles that changed,
+ *            or had a neighbouring tile change, in the previous step. Still and empty areas cost nothing.
+ *          - Engine::LOOKUP steps the world in 2x2 blocks. The 16 cells around a block form a key into a
+ *            65536 entry table, built from the rule, holding the next values of the 4 cells in the block.
+ *          - Engine::SIMD keeps the Grid byte layout and sums the neighbours of a vector of cells at once,
+ *            32 cells per instruction with AVX2 or 16 with SSE2, falling back to plain loops on other targets.
+ *          - Engine::TEMPORAL advances the world World::TEMPORAL_DEPTH generations per pass over memory. Each tile
+ *            is copied into a small buffer with a halo as wide as the number of generations, stepped there while
+ *            it stays in cache, and only its centre is written back.
+ *
  * @author 963356
  * @date March, 2020
  */
@@ -26,6 +68,23 @@
 #include "world.h"
 #include "grid.h"
 #include "zoo.h"
+#include "adder.h"
+#include "rowkernel.h"
+#include <utility>
+#include <bitset>
+#include <stdexcept>
+#include <algorithm>
+#include <unordered_map>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <limits>
+#include "resources.h"
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
 
 /**
  * World::World()
@@ -39,7 +98,8 @@
  *
  */
 
-World::World():width(0), height(0), total_cells(0), dead_cells(0), alive_cells(0){}
+World::World():width(0), height(0), total_cells(0), alive_cells(0), dead_cells(0), generation(0), toroidal(false), engine(Engine::WINDOW),
+numa(false), tileToroidal(false), trackChanges(false){}
 
 /**
  * World::World(square_size)
@@ -63,7 +123,9 @@ World::World():width(0), height(0), total_cells(0), dead_cells(0), alive_cells(0
 
  World::World(int square_size): width(square_size), height(square_size),
  total_cells(square_size*square_size), alive_cells(0),
- dead_cells(square_size*square_size){
+ dead_cells(square_size*square_size), generation(0), toroidal(false),
+ currState(square_size, square_size), newState(square_size, square_size), engine(Engine::WINDOW), numa(false), tileToroidal(false),
+ trackChanges(false){
 
  }
 
@@ -84,7 +146,9 @@ World::World():width(0), height(0), total_cells(0), dead_cells(0), alive_cells(0
  */
 
  World::World(int _width, int _height): width(_width), height(_height),
- total_cells(_width*_height), alive_cells(0), dead_cells(_width*_height){
+ total_cells(_width*_height), alive_cells(0), dead_cells(_width*_height), generation(0), toroidal(false),
+ currState(_width, _height), newState(_width, _height),
+ engine(Engine::WINDOW), numa(false), tileToroidal(false), trackChanges(false){
 
  }
 
@@ -107,13 +171,29 @@ World::World():width(0), height(0), total_cells(0), dead_cells(0), alive_cells(0
  * @param initial_state
  *      The state of the constructed world.
  */
-World::World(Grid initial_state){
-  this->height=initial_state.get_height();
-  this->width=initial_state.get_width();
-  this->total_cells=initial_state.get_total_cells();
-  this->alive_cells=initial_state.get_alive_cells();
-  this->dead_cells=initial_state.get_dead_cells();
-  this->currState=initial_state;
+World::World(Grid initial_state):generation(0), toroidal(false), engine(Engine::WINDOW), numa(false), tileToroidal(false), trackChanges(false){
+  this->load_state(initial_state);
+}
+
+/**
+ * World::World(initial_state, engine)
+ *
+ * Construct a world using the size and values of an existing grid, stepped by the chosen engine.
+ *
+ * @example
+ *
+ *      // Make a world that steps 64 cells at a time
+ *      World world(Zoo::r_pentomino(), Engine::BITWISE);
+ *
+ * @param initial_state
+ *      The state of the constructed world.
+ *
+ * @param engine
+ *      The engine used to store and step the world.
+ */
+
+World::World(Grid initial_state, Engine engine):generation(0), toroidal(false), engine(engine), numa(false), tileToroidal(false), trackChanges(false){
+  this->load_state(initial_state);
 }
 
 World::~World(){ }
@@ -258,12 +338,45 @@ int World::get_dead_cells() const{
   return this->dead_cells;
 }
 
+/**
+ * World::get_generation()
+ *
+ * Gets how many generations the world has been stepped since it was constructed, or since the generation
+ * it was restored at from a checkpoint. Changing the engine, rule or size of the world does not reset it.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The number of the current generation.
+ */
+
+int64_t World::get_generation() const{
+  return this->generation;
+}
+
+/**
+ * World::get_toroidal()
+ *
+ * Gets the topology the world was last stepped with, so a restored world can carry on as it was.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      True if the last step treated the world as a torus, false if it has never been stepped.
+ */
+
+bool World::get_toroidal() const{
+  return this->toroidal;
+}
+
 /**
  * World::get_state()
  *
- * Return a read-only reference to the current state
+ * Return the current state.
  * The function should be callable from a constant context.
- * The function should not invoke a copy the current state.
+ * The function should not invoke a copy the current state. Engines which step a Grid return one sharing its cells,
+ * which the world never writes again, so a snapshot costs O(1) however large the world.
+ * Engine::NAIVE, Engine::BITWISE and Engine::HASHLIFE store their cells another way, so they are converted.
+ * The state is returned as a Grid rather than a GridView so it stays valid as the world steps on, for queues and
+ * threads holding snapshots. World::view() reads the state in place where it does not need to outlive a step.
  *
  * @example
  *
@@ -280,13 +393,378 @@ int World::get_dead_cells() const{
  *      std::cout << read_only_world.get_state() << std::endl;
  *
  * @return
- *      A reference to the current state.
+ *      The current state.
  */
 
 Grid World::get_state() const{
-  Grid result=this->currState;
-  return result;
+  if (this->engine==Engine::BITWISE){
+    return this->currBits.to_grid();
+  }
+  if (this->engine==Engine::HASHLIFE){
+    return this->life.to_grid(0, 0, this->width, this->height);
+  }
+  if (this->engine==Engine::NAIVE){
+    Grid result(this->width, this->height);
+    for (int y=0; y<this->height; y++){
+      const Cell* row=this->currHalo.data()+(y+1)*(this->width+2)+1;
+      std::copy(row, row+this->width, result.row_data(y, BulkKey()));
+    }
+    result.set_alive_cells(this->alive_cells, BulkKey());
+    return result;
+  }
+  return this->currState;
+}
+
+/**
+ * World::view()
+ *
+ * Gets a read-only view of the current state without copying it, for printing, saving, or merging
+ * part of the world into another grid. Engine::NAIVE is viewed inside its halo padded buffer.
+ * Engine::BITWISE and Engine::HASHLIFE do not store a Cell per cell, so their state is converted into
+ * a Grid kept by the world and viewed there. That Grid costs a byte per cell, undoing the memory saved by
+ * Engine::BITWISE until the engine or size of the world changes, so huge packed worlds are better saved with
+ * World::checkpoint, which packs the cells without a byte copy.
+ *
+ * @example
+ *
+ *      // Print the top left corner of a huge world without copying the rest
+ *      std::cout << world.view().crop(0, 0, 80, 24) << std::endl;
+ *
+ * @return
+ *      A view of the current state, valid until the world is next stepped or changed.
+ */
+
+GridView World::view(){
+  if (this->engine==Engine::NAIVE){
+    return GridView(this->currHalo.data()+(this->width+2)+1, this->width, this->height, this->width+2,
+                    this->alive_cells);
+  }
+  return this->view_state().view();
+}
+
+/**
+ * World::get_engine()
+ *
+ * Gets the engine used to store and step the world.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The current engine.
+ */
+
+Engine World::get_engine() const{
+  return this->engine;
+}
+
+/**
+ * World::set_engine(engine)
+ *
+ * Switch the engine used to store and step the world, keeping the current state.
+ *
+ * @example
+ *
+ *      // Make a world
+ *      World world(Zoo::glider());
+ *
+ *      // Continue stepping it 64 cells at a time
+ *      world.set_engine(Engine::BITWISE);
+ *
+ * @param engine
+ *      The engine to use from now on.
+ *
+ * @throws
+ *      std::runtime_error if the engine is Engine::HASHLIFE and the rule gives birth with 0 neighbours.
+ *      The world is left unchanged, still on its previous engine.
+ */
+
+void World::set_engine(Engine engine){
+  Grid state=this->get_state();
+  Engine previous=this->engine;
+  this->engine=engine;
+  try{
+    this->load_state(state);
+  }
+  catch (...){
+    //World::load_state refuses the engine before touching any buffer, so the world is as it was
+    this->engine=previous;
+    throw;
+  }
+}
+
+/**
+ * World::get_rule()
+ *
+ * Gets the rule the world is stepped with.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The current rule.
+ */
+
+Rule World::get_rule() const{
+  return this->rule;
+}
+
+/**
+ * World::set_rule(rule)
+ *
+ * Change the rule the world is stepped with from the next step onwards, for every engine.
+ * Whatever an engine cached for the old rule, such as the sleeping tiles of Engine::TILED or the table
+ * of Engine::LOOKUP, is dropped.
+ *
+ * @example
+ *
+ *      // Make a world running HighLife
+ *      World world(grid);
+ *      world.set_rule(Rule::parse("B36/S23"));
+ *
+ * @param rule
+ *      The new rule.
+ *
+ * @throws
+ *      std::runtime_error if the engine is Engine::HASHLIFE and the rule gives birth with 0 neighbours.
+ */
+
+void World::set_rule(const Rule& rule){
+  if (this->engine==Engine::HASHLIFE){
+    this->life.set_rule(rule);
+  }
+  this->rule=rule;
+  //Tiles asleep under the old rule may wake under the new one, so every tile is computed on the next step
+  this->tileChanged.clear();
+  this->lookupTable.clear();
+}
+
+/**
+ * World::get_threads()
+ *
+ * Gets the number of threads Engine::PARALLEL steps the world with.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The number of threads, or 0 if the thread pool has not been started yet.
+ */
+
+int World::get_threads() const{
+  if (this->pool==nullptr){
+    return 0;
+  }
+  return this->pool->get_threads();
+}
+
+/**
+ * World::set_threads(threads)
+ *
+ * Start the thread pool used by Engine::PARALLEL with the given number of threads.
+ * The pool persists between steps, it is only restarted when the number of threads changes.
+ * If never called, the pool is started on the first parallel step with one thread per core.
+ *
+ * @example
+ *
+ *      // Make a world stepped by 8 threads
+ *      World world(grid, Engine::PARALLEL);
+ *      world.set_threads(8);
+ *
+ * @param threads
+ *      The number of threads to step the world with.
+ */
+
+void World::set_threads(int threads){
+  if (threads<1){
+    threads=1;
+  }
+  if (this->pool==nullptr || this->pool->get_threads()!=threads || this->pool->get_pinned()!=this->numa){
+    this->pool=std::make_shared<ThreadPool>(threads, this->numa);
+    //The bands have moved to other threads, so they are placed again on the next step
+    this->placed[0].reset();
+    this->placed[1].reset();
+  }
+}
+
+/**
+ * World::get_numa()
+ *
+ * Gets whether Engine::PARALLEL runs in NUMA mode.
+ *
+ * @return
+ *      True if the world is in NUMA mode.
+ */
 
+bool World::get_numa() const{
+  return this->numa;
+}
+
+/**
+ * World::set_numa(numa)
+ *
+ * Turn NUMA mode on or off for Engine::PARALLEL, on machines where each socket has memory of its own.
+ *      - The thread pool is restarted with every thread pinned to a core, taking cores node by node.
+ *      - Before the next parallel step each band of rows of both buffers is written first by the thread that
+ *        steps it, so the kernel places its memory on that thread's node. A buffer is placed again whenever it
+ *        is replaced, such as when the world is resized or restored.
+ *      - Bands are split the same way every step and band i always runs on thread i, so they stay local.
+ * World::get_placement reports which nodes the buffers ended up on. Other engines ignore the mode.
+ *
+ * @example
+ *
+ *      // Step a huge world on 32 pinned threads, then check where its memory landed
+ *      World world(Grid(100000, 100000), Engine::PARALLEL);
+ *      world.set_numa(true);
+ *      world.set_threads(32);
+ *      world.step();
+ *      std::vector<size_t> nodes = world.get_placement();
+ *
+ * @param numa
+ *      True to turn NUMA mode on.
+ */
+
+void World::set_numa(bool numa){
+  this->numa=numa;
+  if (this->pool!=nullptr){
+    this->set_threads(this->pool->get_threads());
+  }
+}
+
+/**
+ * World::get_placement()
+ *
+ * Reports how many bytes of the current and next state sit on each NUMA node, as add_placement finds them.
+ * Pages never written yet live nowhere and are not counted.
+ * Engine::NAIVE, Engine::BITWISE and Engine::HASHLIFE do not keep their cells in Grid buffers, so report nothing.
+ *
+ * @example
+ *
+ *      // Print the share of the world on each node
+ *      std::vector<size_t> nodes = world.get_placement();
+ *      for (size_t node=0; node<nodes.size(); node++) {
+ *          std::cout << "Node " << node << ": " << nodes[node] << " bytes" << std::endl;
+ *      }
+ *
+ * @return
+ *      The number of bytes on each node, indexed by node.
+ *
+ * @throws
+ *      std::runtime_error if the kernel cannot report the placement.
+ */
+
+std::vector<size_t> World::get_placement() const{
+  std::vector<size_t> nodes;
+  for (const Grid* state : {&this->currState, &this->newState}){
+    if (state->get_total_cells()>0){
+      add_placement(state->row(0), state->get_total_cells(), nodes);
+    }
+  }
+  return nodes;
+}
+
+/**
+ * World::is_placed(state)
+ *
+ * Private helper function to check whether the cells of one of the buffers were placed by World::place_bands.
+ * The buffers placed are remembered by weak pointers, so a new buffer allocated where an old one was freed
+ * is never mistaken for it.
+ *
+ * @param state
+ *      The current or next state.
+ *
+ * @return
+ *      True if the cells of the state were placed.
+ */
+
+bool World::is_placed(const Grid& state) const{
+  std::weak_ptr<const void> owner=state.get_owner();
+  for (const std::weak_ptr<const void>& cells : this->placed){
+    if (!cells.owner_before(owner) && !owner.owner_before(cells) && !cells.expired()){
+      return true;
+    }
+  }
+  return false;
+}
+
+/**
+ * World::place_bands()
+ *
+ * Private helper function run before each step of Engine::PARALLEL in NUMA mode. Any buffer not placed yet is
+ * given a new block of cells which nothing has written, and each band of its rows is copied into the block by the
+ * pool thread which steps that band, the bands split exactly as World::step_parallel splits them. The kernel puts
+ * each page on the node of the first thread to write it, so every band lands on the node stepping it.
+ */
+
+void World::place_bands(){
+  int height=this->get_height();
+  int width=this->get_width();
+  int bands=std::min(this->pool->get_threads(), height);
+  for (Grid* state : {&this->currState, &this->newState}){
+    if (this->is_placed(*state) || bands<=0){
+      continue;
+    }
+    //The old cells are read from a copy sharing them, and freed once every band has been copied
+    Grid before=*state;
+    state->reallocate(BulkKey());
+    this->pool->run(bands, [&](int band){
+      for (int y=(height*band)/bands; y<(height*(band+1))/bands; y++){
+        std::copy(before.row(y), before.row(y)+width, state->row_data(y, BulkKey()));
+      }
+    });
+    state->set_alive_cells(before.get_alive_cells(), BulkKey());
+  }
+  this->placed[0]=this->currState.get_owner();
+  this->placed[1]=this->newState.get_owner();
+}
+
+/**
+ * World::load_state(state)
+ *
+ * Private helper function to replace the current state and size of the world.
+ * The state is stored in whichever buffers the current engine steps.
+ *
+ * @throws
+ *      std::runtime_error if the engine is Engine::HASHLIFE and the rule gives birth with 0 neighbours.
+ *
+ * @param state
+ *      The new current state.
+ */
+
+void World::load_state(const Grid& state){
+  if (this->engine==Engine::HASHLIFE && this->rule.next(false, 0)){
+    throw std::runtime_error("HashLife cannot run rules with B0 on an unbounded plane");
+  }
+  this->width=state.get_width();
+  this->height=state.get_height();
+  this->total_cells=state.get_total_cells();
+  this->alive_cells=state.get_alive_cells();
+  this->dead_cells=state.get_dead_cells();
+  this->currState=Grid();
+  this->newState=Grid();
+  this->currBits=BitGrid();
+  this->newBits=BitGrid();
+  this->life=HashLife();
+  this->currHalo.clear();
+  this->newHalo.clear();
+  this->viewState=Grid();
+  this->tileChanged.clear();
+  if (this->engine==Engine::NAIVE){
+    int stride=this->width+2;
+    this->currHalo.assign(stride*(this->height+2), Cell::DEAD);
+    this->newHalo.assign(stride*(this->height+2), Cell::DEAD);
+    for (int y=0; y<this->height; y++){
+      const Cell* row=state.row(y);
+      std::copy(row, row+this->width, this->currHalo.data()+(y+1)*stride+1);
+    }
+  }
+  else if (this->engine==Engine::BITWISE){
+    this->currBits=BitGrid(state);
+    this->newBits=BitGrid(this->width, this->height);
+  }
+  else if (this->engine==Engine::HASHLIFE){
+    this->life=HashLife(state);
+    this->life.set_rule(this->rule);
+  }
+  else{
+    this->currState=state;
+    //Both buffers come from the memory resource of the state, so a state on huge pages is stepped on huge pages
+    this->newState=Grid(this->width, this->height, state.get_resource());
+  }
 }
 
 /**
@@ -310,11 +788,7 @@ Grid World::get_state() const{
  */
 
 void World::resize(int square_size){
-  Grid currentState=this->get_state();
-  currentState.resize(square_size);
-  this->currState=currentState;
-  this->dead_cells=(square_size*square_size)-currentState.get_alive_cells();
-  this->alive_cells=currentState.get_alive_cells();
+  this->resize(square_size, square_size);
 }
 
 /**
@@ -343,13 +817,13 @@ void World::resize(int square_size){
  void World::resize(int new_width, int new_height){
    Grid currentState=this->get_state();
    currentState.resize(new_width, new_height);
-   this->currState=currentState;
-   this->dead_cells=(new_width*new_height)-currentState.get_alive_cells();
-   this->alive_cells=currentState.get_alive_cells();
+   this->load_state(currentState);
+   this->history.clear();
+   this->record_history();
  }
 
 /**
- * World::count_neighbours(x, y, toroidal)
+ * World::count_neighbours(x, y)
  *
  * Private helper function to count the number of alive neighbours of a cell.
  * The function should not be visible from outside the World class.
@@ -358,10 +832,14 @@ void World::resize(int square_size){
  * Ignore the centre coordinate, a cell is not its own neighbour.
  * Attempt to keep the logic as simple, expressive, and readable as possible.
  *
- * If toroidal = false then skip any neighbours that would be outside of the grid,
- * this assumes the grid is Cell::DEAD outside its bounds.
+ * Neighbours are read from the padded current state buffer, whose one cell halo World::fill_halo(toroidal)
+ * fills before each step, so there are no edge cases to check and the topology is already decided by the halo.
+ *
+ * If the halo was filled with toroidal = false then it is Cell::DEAD, this assumes the grid is Cell::DEAD
+ * outside its bounds.
  *
- * If toroidal = true then correctly wrap out of bounds coordinates to the opposite side of the grid.
+ * If the halo was filled with toroidal = true then it holds the cells of the opposite edges, correctly
+ * wrapping out of bounds coordinates to the opposite side of the grid.
  *
  * This function is in World and not Grid because the 3x3 sized neighbourhood is specific to Conway's Game of Life,
  * while Grid is more generic to any 2D grid based cellular automaton.
@@ -372,659 +850,1851 @@ void World::resize(int square_size){
  * @param y
  *      The y coordinate of the centre of the neighbourhood.
  *
+ * @return
+ *      Returns the number of alive neighbours.
+ */
+int World::count_neighbours(int x, int y){
+  //The halo holds the wrapped or dead cells for the topology, so every cell has 8 neighbours in the buffer
+  int stride=this->get_width()+2;
+  const Cell* up=this->currHalo.data()+y*stride+x;
+  const Cell* mid=up+stride;
+  const Cell* down=mid+stride;
+  return (up[0]==Cell::ALIVE)+(up[1]==Cell::ALIVE)+(up[2]==Cell::ALIVE)
+        +(mid[0]==Cell::ALIVE)+(mid[2]==Cell::ALIVE)
+        +(down[0]==Cell::ALIVE)+(down[1]==Cell::ALIVE)+(down[2]==Cell::ALIVE);
+}
+
+/**
+ * west_word(row, j, words, last_bit, toroidal)
+ *
+ * Shifts word j of a bit-packed row so bit i holds the cell to the west (x-1) of the cell in bit i.
+ *
+ * @param row
+ *      The words of the row, or nullptr for a row of dead cells.
+ *
+ * @param j
+ *      The index of the word to shift.
+ *
+ * @param words
+ *      The number of words in the row.
+ *
+ * @param last_bit
+ *      The bit of the last word holding the last cell of the row.
+ *
  * @param toroidal
- *      If true then the step will consider the grid as a torus, where the left edge
- *      wraps to the right edge and the top to the bottom.
+ *      If true the west neighbour of the first cell is the last cell of the row, otherwise it is dead.
  *
  * @return
- *      Returns the number of alive neighbours.
+ *      The shifted word.
  */
-int World::count_neighbours(int x, int y, bool toroidal){
-  int height=this->get_height();
-  int width=this->get_width();
 
-  int count=0;
+static inline uint64_t west_word(const uint64_t* row, int j, int words, int last_bit, bool toroidal){
+  if (row==nullptr){
+    return 0;
+  }
+  uint64_t carry=0;
+  if (j>0){
+    carry=row[j-1]>>63;
+  }
+  else if (toroidal){
+    carry=(row[words-1]>>last_bit)&1;
+  }
+  return (row[j]<<1)|carry;
+}
+
+/**
+ * east_word(row, j, words, last_bit, toroidal)
+ *
+ * Shifts word j of a bit-packed row so bit i holds the cell to the east (x+1) of the cell in bit i.
+ * The parameters match west_word.
+ *
+ * @return
+ *      The shifted word.
+ */
+
+static inline uint64_t east_word(const uint64_t* row, int j, int words, int last_bit, bool toroidal){
+  if (row==nullptr){
+    return 0;
+  }
+  uint64_t carry=0;
+  if (j<words-1){
+    carry=row[j+1]<<63;
+  }
+  else if (toroidal){
+    carry=(row[0]&1)<<last_bit;
+  }
+  return (row[j]>>1)|carry;
+}
+
+/**
+ * World::fill_halo(toroidal)
+ *
+ * Private helper function to fill the one cell halo around the padded current state buffer of Engine::NAIVE.
+ *
+ * On a torus the halo rows and columns are copies of the opposite edges, including the corners,
+ * otherwise they are cleared to Cell::DEAD. Either way the buffer is reused, nothing is allocated.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ */
 
-  Grid g=this->get_state();
-  //If the shape is toroidal
+void World::fill_halo(bool toroidal){
+  int width=this->get_width();
+  int height=this->get_height();
+  if (width==0 || height==0){
+    return;
+  }
+  int stride=width+2;
+  Cell* cells=this->currHalo.data();
+  for (int y=1; y<=height; y++){
+    Cell* row=cells+y*stride;
+    row[0]=toroidal ? row[width] : Cell::DEAD;
+    row[width+1]=toroidal ? row[1] : Cell::DEAD;
+  }
+  Cell* top=cells;
+  Cell* bottom=cells+(height+1)*stride;
   if (toroidal){
-    //If the shape is in the inner grid
-    if (x>0 && x<(width-1) && y>0 && y<(height-1)){
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
-    }
-    //If the coordinate is on the left in between the corners
-    else if (x==0 && y>0 && y<(height-1)){
-      //Check the left
-      if (g.get((width-1), y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top left
-      if (g.get(width-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom left
-      if (g.get(width-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-    }
-    //If the coordinate is on the right in between the corners
-    else if (x==(width-1) && y>0 && y<(height-1)){
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(0, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(0, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(0, y-1)==Cell::ALIVE){
-        count++;
-      }
+    std::copy(cells+height*stride, cells+(height+1)*stride, top);
+    std::copy(cells+stride, cells+2*stride, bottom);
+  }
+  else{
+    std::fill(top, top+stride, Cell::DEAD);
+    std::fill(bottom, bottom+stride, Cell::DEAD);
+  }
+}
+
+/**
+ * World::step_bitwise(toroidal)
+ *
+ * Private helper function to take one step of Engine::BITWISE.
+ * Conway's rule is stepped by the kernel specialised for ConwayRule, and every other rule by the kernel for Rule.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ */
+
+void World::step_bitwise(bool toroidal){
+  if (this->rule==ConwayRule::rule){
+    this->step_bitwise(toroidal, ConwayRule());
+  }
+  else{
+    this->step_bitwise(toroidal, this->rule);
+  }
+}
+
+/**
+ * World::step_bitwise(toroidal, transition)
+ *
+ * Private helper function to take one step of Engine::BITWISE with the rule of a given type.
+ *
+ * Reads from the current state BitGrid and writes to the next state BitGrid, then swaps them.
+ * The eight neighbours of 64 cells are summed at once by a tree of bitwise full adders into
+ * four count bits, and the rules are applied to the count bits with bitwise logic.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ *
+ * @param transition
+ *      The rule of the world, either as a Rule or as a StaticRule fixing it at compile time.
+ */
+
+template <typename Transition>
+void World::step_bitwise(bool toroidal, const Transition& transition){
+  int height=this->get_height();
+  int width=this->get_width();
+  if (width==0 || height==0){
+    return;
+  }
+  int words=this->currBits.get_words_per_row();
+  int last_bit=(width-1)%64;
+  uint64_t last_mask=this->currBits.last_word_mask();
+  int alive=0;
+  for (int y=0; y<height; y++){
+    const uint64_t* up=nullptr;
+    const uint64_t* down=nullptr;
+    if (y>0){
+      up=this->currBits.row(y-1);
     }
-    //If the coordinate is on top in between the corners
-    else if (x>0 && x<(width-1) && y==0){
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, (height-1))==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, height-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, height-1)==Cell::ALIVE){
-        count++;
-      }
+    else if (toroidal){
+      up=this->currBits.row(height-1);
     }
-    //If the coordinate is on bottom in between the corners
-    else if (x>0 && x<(width-1) && y==(height-1)){
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
+    if (y<height-1){
+      down=this->currBits.row(y+1);
     }
-
-    //If the coordinate is the top left corner
-    else if(x==0 && y==0){
-      //Check the left
-      if (g.get(width-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, height-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(width-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(width-1, height-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, height-1)==Cell::ALIVE){
-        count++;
-      }
+    else if (toroidal){
+      down=this->currBits.row(0);
     }
-    //If the coordinate is the top right corner
-    else if(x==(width-1) && y==0){
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-        //std::cout<<"left "<<count<<std::endl;
-      }
-      //Check the right
-      if (g.get(0, y)==Cell::ALIVE){
-        count++;
-        //std::cout<<"right "<<count<<std::endl;
-      }
-      //Check the top
-      if (g.get(x, (height-1))==Cell::ALIVE){
-        count++;
-        //std::cout<<"top "<<count<<std::endl;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-        //std::cout<<"bottom "<<count<<std::endl;
+    const uint64_t* mid=this->currBits.row(y);
+    uint64_t* out=this->newBits.row(y);
+    for (int j=0; j<words; j++){
+      uint64_t bit0, bit1, bit2, bit3;
+      sum_neighbours(west_word(up, j, words, last_bit, toroidal), (up==nullptr) ? 0 : up[j],
+                     east_word(up, j, words, last_bit, toroidal),
+                     west_word(mid, j, words, last_bit, toroidal), east_word(mid, j, words, last_bit, toroidal),
+                     west_word(down, j, words, last_bit, toroidal), (down==nullptr) ? 0 : down[j],
+                     east_word(down, j, words, last_bit, toroidal), bit0, bit1, bit2, bit3);
+      //Apply the rule to the four bit planes of the neighbour counts
+      uint64_t next=transition.next_bits(mid[j], bit0, bit1, bit2, bit3);
+      if (j==words-1){
+        next&=last_mask;
+      }
+      out[j]=next;
+      alive+=std::bitset<64>(next).count();
+      if (this->trackChanges){
+        for (uint64_t flipped=next^mid[j]; flipped!=0; flipped&=flipped-1){
+          int bit=__builtin_ctzll(flipped);
+          this->changes.push_back(Change{j*64+bit, y, (bool)((next>>bit)&1)});
+        }
       }
+    }
+  }
+  std::swap(this->currBits, this->newBits);
+  this->alive_cells=alive;
+  this->dead_cells=this->get_total_cells()-alive;
+}
 
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-        //std::cout<<"bottom-left "<<count<<std::endl;
-      }
-      //Check the top-left
-      if (g.get(x-1, height-1)==Cell::ALIVE){
-        count++;
-        //std::cout<<"top-left "<<count<<std::endl;
-      }
-      //Check the bottom-right
-      if (g.get(0, y+1)==Cell::ALIVE){
-        count++;
-        //std::cout<<"bottom-right "<<count<<std::endl;
-      }
-      //Check the top-right
-      if (g.get(0, height-1)==Cell::ALIVE){
-        count++;
-        //std::cout<<"top-right "<<count<<std::endl;
-      }
+/**
+ * diff_row(before, after, x0, x1, y, changes)
+ *
+ * Appends the cells [x0, x1) of row y which differ between two generations to a list of changes.
+ * Cells are compared 8 at a time, so a row that did not change costs a few comparisons.
+ */
 
+static void diff_row(const Cell* before, const Cell* after, int x0, int x1, int y, std::vector<Change>& changes){
+  int x=x0;
+  for (; x+8<=x1; x+=8){
+    uint64_t a;
+    uint64_t b;
+    std::memcpy(&a, before+x, 8);
+    std::memcpy(&b, after+x, 8);
+    if (a==b){
+      continue;
     }
-    //If the coordinate is the bottom left corner
-    else if(x==0 && y==(height-1)){
-      //Check the left
-      if (g.get(width-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(0, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(width-1, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(width-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
-    }
-    //If the coordinate is the bottom right corner
-    else if(x==(width-1) && y==(height-1)){
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(0, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(0, 0)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(0, y-1)==Cell::ALIVE){
-        count++;
+    for (int i=x; i<x+8; i++){
+      if (before[i]!=after[i]){
+        changes.push_back(Change{i, y, after[i]==Cell::ALIVE});
       }
     }
   }
-  //If the shape isn't toroidal
-  else{
-    //If the shape is in the inner grid
-    if (x>0 && x<(width-1) && y>0 && y<(height-1)){
-      g.get(x, y+1);
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
+  for (; x<x1; x++){
+    if (before[x]!=after[x]){
+      changes.push_back(Change{x, y, after[x]==Cell::ALIVE});
     }
-    //If the coordinate is on the left in between the corners
-    else if (x==0 && y>0 && y<(height-1)){
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
+  }
+}
+
+/**
+ * World::diff_state(before)
+ *
+ * Private helper function to list the cells born and died between an earlier generation and the current one,
+ * for the engines whose kernels do not list them as they step.
+ *
+ * @param before
+ *      The earlier generation, the same size as the world.
+ */
+
+void World::diff_state(const Grid& before){
+  Grid window;
+  const Grid* after=&this->currState;
+  if (this->engine==Engine::HASHLIFE){
+    window=this->get_state();
+    after=&window;
+  }
+  for (int y=0; y<this->height; y++){
+    diff_row(before.row(y), after->row(y), 0, this->width, y, this->changes);
+  }
+}
+
+/**
+ * World::step_rows(y0, y1, toroidal, changes)
+ *
+ * Private helper function to compute rows [y0, y1) of the next state grid for Engine::WINDOW.
+ * Implemented by invoking World::step_rect over the full width of the rows.
+ *
+ * The alive and dead counts of the next state grid are not updated.
+ *
+ * @param y0
+ *      The first row to compute.
+ *
+ * @param y1
+ *      One past the last row to compute.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ *
+ * @param changes
+ *      If not nullptr, the cells born and died in the rows are appended to it.
+ *
+ * @return
+ *      Returns the number of alive cells written to the rows.
+ */
+
+int World::step_rows(int y0, int y1, bool toroidal, std::vector<Change>* changes){
+  return this->step_rect(0, y0, this->get_width(), y1, toroidal, nullptr, changes);
+}
+
+/**
+ * World::step_rect(x0, y0, x1, y1, toroidal, changed, changes)
+ *
+ * Private helper function to compute the cells [x0, x1) by [y0, y1) of the next state grid.
+ *
+ * The current state is read in place through row pointers to the rows above, on, and below each row.
+ * Walking along the row keeps the alive counts of three columns of that 3x3 window, so moving one cell
+ * to the right only adds up one new column. The centre cell is subtracted as it is not its own neighbour.
+ *
+ * The alive and dead counts of the next state grid are not updated.
+ *
+ * @param x0, y0
+ *      The top left cell to compute.
+ *
+ * @param x1, y1
+ *      One past the bottom right cell to compute.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ *
+ * @param changed
+ *      If not nullptr, set to whether any computed cell differs from the current state.
+ *
+ * @param changes
+ *      If not nullptr, the cells born and died in the rectangle are appended to it, row by row
+ *      while each row is still in cache.
+ *
+ * @return
+ *      Returns the number of alive cells written to the rectangle.
+ */
+
+int World::step_rect(int x0, int y0, int x1, int y1, bool toroidal, bool* changed, std::vector<Change>* changes){
+  int height=this->get_height();
+  int width=this->get_width();
+  int alive=0;
+  bool differs=false;
+  for (int y=y0; y<y1; y++){
+    const Cell* up=nullptr;
+    const Cell* down=nullptr;
+    if (y>0){
+      up=this->currState.row(y-1);
     }
-    //If the coordinate is on the right in between the corners
-    else if (x==(width-1) && y>0 && y<(height-1)){
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
+    else if (toroidal){
+      up=this->currState.row(height-1);
     }
-    //If the coordinate is on top in between the corners
-    else if (x>0 && x<(width-1) && y==0){
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
+    if (y<height-1){
+      down=this->currState.row(y+1);
     }
-    //If the coordinate is on bottom in between the corners
-    else if (x>0 && x<(width-1) && y==(height-1)){
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
+    else if (toroidal){
+      down=this->currState.row(0);
     }
-
-    //If the coordinate is the top left corner
-    else if(x==0 && y==0){
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-right
-      if (g.get(x+1, y+1)==Cell::ALIVE){
-        count++;
-      }
+    const Cell* mid=this->currState.row(y);
+    Cell* out=this->newState.row_data(y, BulkKey());
+    //The alive count of column x in the rows y-1, y and y+1
+    auto column=[&](int x){
+      int sum=(mid[x]==Cell::ALIVE);
+      if (up!=nullptr){
+        sum+=(up[x]==Cell::ALIVE);
+      }
+      if (down!=nullptr){
+        sum+=(down[x]==Cell::ALIVE);
+      }
+      return sum;
+    };
+    int left=0;
+    if (x0>0){
+      left=column(x0-1);
     }
-    //If the coordinate is the top right corner
-    else if(x==(width-1) && y==0){
-      //Check the bottom
-      if (g.get(x, y+1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the bottom-left
-      if (g.get(x-1, y+1)==Cell::ALIVE){
-        count++;
-      }
+    else if (toroidal){
+      left=column(width-1);
     }
-    //If the coordinate is the bottom left corner
-    else if(x==0 && y==(height-1)){
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the right
-      if (g.get(x+1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-right
-      if (g.get(x+1, y-1)==Cell::ALIVE){
-        count++;
-      }
+    int centre=column(x0);
+    for (int x=x0; x<x1; x++){
+      int right=0;
+      if (x<width-1){
+        right=column(x+1);
+      }
+      else if (toroidal){
+        right=column(0);
+      }
+      bool self=(mid[x]==Cell::ALIVE);
+      int count=left+centre+right-self;
+      //Look the next value of the cell up in the rule's transition table
+      bool next=this->rule.next(self, count);
+      out[x]=next ? Cell::ALIVE : Cell::DEAD;
+      alive+=next;
+      differs|=(out[x]!=mid[x]);
+      left=centre;
+      centre=right;
     }
-    //If the coordinate is the bottom right corner
-    else if(x==(width-1) && y==(height-1)){
-      //Check the top
-      if (g.get(x, y-1)==Cell::ALIVE){
-        count++;
-      }
-      //Check the left
-      if (g.get(x-1, y)==Cell::ALIVE){
-        count++;
-      }
-      //Check the top-left
-      if (g.get(x-1, y-1)==Cell::ALIVE){
-        count++;
-      }
+    if (changes!=nullptr){
+      diff_row(mid, out, x0, x1, y, *changes);
     }
   }
-  return count;
+  if (changed!=nullptr){
+    *changed=differs;
+  }
+  return alive;
 }
 
 /**
- * World::step(toroidal)
- *
- * Take one step in Conway's Game of Life.
+ * World::step_tiled(toroidal)
  *
- * Reads from the current state grid and writes to the next state grid. Then swaps the grids.
- * Should be implemented by invoking World::count_neighbours(x, y, toroidal).
- * Swapping the grids should be done in O(1) constant time, and should not invoke a copy.
- * Try and boil the logic down to the fewest and most simple conditional statements.
+ * Private helper function to take one step of Engine::TILED.
  *
- * Rules: https://en.wikipedia.org/wiki/Conway%27s_Game_of_Life
- *      - Any live cell with fewer than two live neighbours dies, as if by underpopulation.
- *      - Any live cell with two or three live neighbours lives on to the next generation.
- *      - Any live cell with more than three live neighbours dies, as if by overpopulation.
- *      - Any dead cell with exactly three live neighbours becomes a live cell, as if by reproduction.
+ * The world is split into World::TILE_SIZE square tiles. A tile is only computed, by World::step_rect, if it
+ * or one of its eight neighbouring tiles changed in the previous step. Any other tile is asleep: its cells
+ * matched the previous state, so the next state buffer, which still holds the previous state, already holds
+ * its cells and it is left alone. Each tile remembers its alive count so sleeping tiles are not recounted.
+ * A tile only sleeps under the topology and rule it was computed with, so changing either wakes every tile.
  *
  * @param toroidal
- *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
- *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
  */
 
-void World::step(bool toroidal){
-  Grid currState=this->get_state();
-  int height=this->get_height();
+void World::step_tiled(bool toroidal){
   int width=this->get_width();
-  int count;
-  Grid newState(width, height);
+  int height=this->get_height();
+  int tilesX=(width+TILE_SIZE-1)/TILE_SIZE;
+  int tilesY=(height+TILE_SIZE-1)/TILE_SIZE;
+  //After the state is replaced, or the topology or rule the tiles slept under changes, every tile counts
+  //as changed, so every tile is computed once
+  if ((int)this->tileChanged.size()!=tilesX*tilesY || this->tileToroidal!=toroidal || this->tileRule!=this->rule){
+    this->tileToroidal=toroidal;
+    this->tileRule=this->rule;
+    this->tileChanged.assign(tilesX*tilesY, 1);
+    this->tileNextChanged.assign(tilesX*tilesY, 0);
+    this->tileAlive.assign(tilesX*tilesY, 0);
+  }
   int alive=0;
-  for (int h=0; h<height; h++){
-    for (int w=0; w<width; w++){
-      count=this->count_neighbours(w, h, toroidal);
-      //If the cell has fewer than two neighbours, kill it
-      if (count<2){
-        newState.set(w,h, Cell::DEAD);
-      }
-      //If a living cell has two or three neighbours, let it live
-      else if ((count==2 || count==3) && currState.get(w, h)==Cell::ALIVE){
-        newState.set(w,h, Cell::ALIVE);
-        alive++;
-      }
-      //If a living cell has more than three neighbours, kill it
-      else if (count>3 && currState.get(w, h)==Cell::ALIVE){
-        newState.set(w,h, Cell::DEAD);
-      }
-      else if (count==3 && currState.get(w, h)==Cell::DEAD){
-        newState.set(w,h, Cell::ALIVE);
-        alive++;
-      }
+  for (int ty=0; ty<tilesY; ty++){
+    for (int tx=0; tx<tilesX; tx++){
+      bool active=false;
+      for (int dy=-1; dy<=1 && !active; dy++){
+        for (int dx=-1; dx<=1 && !active; dx++){
+          int nx=tx+dx;
+          int ny=ty+dy;
+          if (toroidal){
+            nx=(nx+tilesX)%tilesX;
+            ny=(ny+tilesY)%tilesY;
+          }
+          else if (nx<0 || ny<0 || nx>=tilesX || ny>=tilesY){
+            continue;
+          }
+          active=this->tileChanged[ny*tilesX+nx];
+        }
+      }
+      int tile=ty*tilesX+tx;
+      bool changed=false;
+      if (active){
+        int x0=tx*TILE_SIZE;
+        int y0=ty*TILE_SIZE;
+        int x1=std::min(x0+TILE_SIZE, width);
+        int y1=std::min(y0+TILE_SIZE, height);
+        this->tileAlive[tile]=this->step_rect(x0, y0, x1, y1, toroidal, &changed,
+                                              this->trackChanges ? &this->changes : nullptr);
+      }
+      this->tileNextChanged[tile]=changed;
+      alive+=this->tileAlive[tile];
     }
   }
-  int dead=this->get_total_cells()-alive;
+  std::swap(this->tileChanged, this->tileNextChanged);
+  this->newState.set_alive_cells(alive, BulkKey());
+  std::swap(this->currState, this->newState);
   this->alive_cells=alive;
-  this->dead_cells=dead;
-  this->newState=currState;
-  this->currState=newState;
+  this->dead_cells=this->get_total_cells()-alive;
 }
 
-void World::step(){
-  Grid currState=this->get_state();
+/**
+ * World::step_parallel(toroidal)
+ *
+ * Private helper function to take one step of Engine::PARALLEL.
+ *
+ * The rows are split into one contiguous horizontal band per thread and each band is computed by
+ * World::step_rows on its own thread. Every cell of the next state only depends on the current state,
+ * so the result is identical for any number of threads. The alive counts of the bands are summed once
+ * all the bands have finished, and the changes of the bands, if tracked, are joined in order.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ */
+
+void World::step_parallel(bool toroidal){
+  if (this->pool==nullptr){
+    this->set_threads(std::thread::hardware_concurrency());
+  }
+  if (this->numa){
+    this->place_bands();
+  }
   int height=this->get_height();
-  int width=this->get_width();
-  int count;
+  int bands=this->pool->get_threads();
+  if (bands>height){
+    bands=height;
+  }
+  this->bandAlive.assign(bands, 0);
+  if (this->trackChanges){
+    this->bandChanges.resize(bands);
+  }
+  struct Bands {
+      World* world;
+      int height;
+      int bands;
+      bool toroidal;
+  } job={this, height, bands, toroidal};
+  this->pool->run(bands, [](void* context, int band){
+    Bands& job=*(Bands*)context;
+    int y0=(job.height*band)/job.bands;
+    int y1=(job.height*(band+1))/job.bands;
+    std::vector<Change>* changes=nullptr;
+    if (job.world->trackChanges){
+      changes=&job.world->bandChanges[band];
+      changes->clear();
+    }
+    job.world->bandAlive[band]=job.world->step_rows(y0, y1, job.toroidal, changes);
+  }, &job);
   int alive=0;
-  Grid newState(width, height);
-  for (int h=0; h<height; h++){
-    for (int w=0; w<width; w++){
-      count=this->count_neighbours(w, h, false);
+  for (int count : this->bandAlive){
+    alive+=count;
+  }
+  //The bands are in order from top to bottom, so their changes join up in row order
+  if (this->trackChanges){
+    for (int band=0; band<bands; band++){
+      this->changes.insert(this->changes.end(), this->bandChanges[band].begin(), this->bandChanges[band].end());
+    }
+  }
+  this->newState.set_alive_cells(alive, BulkKey());
+  std::swap(this->currState, this->newState);
+  this->alive_cells=alive;
+  this->dead_cells=this->get_total_cells()-alive;
+}
 
-      Cell cell=currState.get(w, h);
-      //If the cell has fewer than two neighbours, kill it
-      if (count<2 && cell==Cell::ALIVE){
-        newState.set(w,h, Cell::DEAD);
-      }
-      else if ((count==2 || count==3) && cell==Cell::ALIVE){
-        newState.set(w,h, Cell::ALIVE);
-        alive++;
-      }
-      else if (count>3 && cell==Cell::ALIVE){
-        newState.set(w,h, Cell::DEAD);
-      }
-      else if (count==3 && cell==Cell::DEAD){
-        newState.set(w,h, Cell::ALIVE);
-        alive++;
+/**
+ * World::build_lookup()
+ *
+ * Private helper function to build the table used by Engine::LOOKUP for the current rule.
+ *
+ * The table is indexed by a 4x4 neighbourhood packed column by column, four bits per column with the
+ * top row in the lowest bit. Entry i holds the next values of the centre 2x2 cells of neighbourhood i,
+ * the top left in bit 0, top right in bit 1, bottom left in bit 2 and bottom right in bit 3.
+ * Each centre cell is decided exactly as World::count_neighbours and the rule would decide it.
+ */
+
+void World::build_lookup(){
+  this->lookupTable.assign(65536, 0);
+  for (int key=0; key<65536; key++){
+    uint8_t result=0;
+    for (int cy=1; cy<=2; cy++){
+      for (int cx=1; cx<=2; cx++){
+        int count=0;
+        for (int dy=-1; dy<=1; dy++){
+          for (int dx=-1; dx<=1; dx++){
+            if (dx!=0 || dy!=0){
+              count+=(key>>((cx+dx)*4+cy+dy))&1;
+            }
+          }
+        }
+        bool self=(key>>(cx*4+cy))&1;
+        if (this->rule.next(self, count)){
+          result|=1<<((cy-1)*2+cx-1);
+        }
       }
     }
+    this->lookupTable[key]=result;
   }
-  int dead=this->get_total_cells()-alive;
-  this->alive_cells=alive;
-  this->dead_cells=dead;
-  this->newState=currState;
-  this->currState=newState;
+  this->lookupRule=this->rule;
 }
 
 /**
- * World::advance(steps, toroidal)
+ * World::step_lookup(toroidal)
  *
- * Advance multiple steps in the Game of Life.
- * Should be implemented by invoking World::step(toroidal).
+ * Private helper function to take one step of Engine::LOOKUP.
  *
- * @param steps
- *      The number of steps to advance the world forward.
+ * Walks the world in 2x2 blocks, reading the four rows from the row above the block to the row two below it.
+ * The four rows are first packed into one nibble per column, reusing the two rows shared with the blocks above. The 4x4 neighbourhood key then slides two columns
+ * to the right per block, so each block only shifts in two nibbles before its next values are read out of the
+ * table built by World::build_lookup. The table is rebuilt whenever
+ * the rule has changed since it was built. Blocks hanging off an odd width or height only count their cells
+ * that are inside the world.
  *
  * @param toroidal
- *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
- *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
  */
 
-void World::advance(int steps, bool toroidal){
-  for (int i=0; i<steps; i++){
-    this->step(toroidal);
+void World::step_lookup(bool toroidal){
+  static const Cell CELLS[2]={Cell::DEAD, Cell::ALIVE};
+  static const int POPULATION[16]={0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4};
+  if (this->lookupTable.empty() || this->lookupRule!=this->rule){
+    this->build_lookup();
+  }
+  int height=this->get_height();
+  int width=this->get_width();
+  //The row at y, wrapped on a torus, or nullptr if it is outside the world
+  auto row_at=[&](int y) -> const Cell*{
+    if (y>=0 && y<height){
+      return this->currState.row(y);
+    }
+    if (toroidal){
+      return this->currState.row(((y%height)+height)%height);
+    }
+    return nullptr;
+  };
+  const uint8_t* table=this->lookupTable.data();
+  //The four cells of each column packed into a nibble, top row in the lowest bit, with one column
+  //before the world and two after it so the last block can read past an odd width
+  this->lookupColumns.assign(width+3, 0);
+  uint8_t* columns=this->lookupColumns.data()+1;
+  int alive=0;
+  for (int y=0; y<height; y+=2){
+    const Cell* rows[4]={row_at(y-1), row_at(y), row_at(y+1), row_at(y+2)};
+    //The bottom two rows of the previous blocks are the top two rows of these blocks
+    int first=2;
+    if (y==0){
+      std::fill(columns, columns+width, 0);
+      first=0;
+    }
+    else{
+      for (int x=0; x<width; x++){
+        columns[x]>>=2;
+      }
+    }
+    for (int r=first; r<4; r++){
+      if (rows[r]==nullptr){
+        continue;
+      }
+      for (int x=0; x<width; x++){
+        columns[x]|=(rows[r][x]==Cell::ALIVE)<<r;
+      }
+    }
+    if (toroidal){
+      columns[-1]=columns[width-1];
+      columns[width]=columns[0];
+      columns[width+1]=columns[(width>1) ? 1 : 0];
+    }
+    Cell* top=this->newState.row_data(y, BulkKey());
+    Cell* bottom=nullptr;
+    if (y+1<height){
+      bottom=this->newState.row_data(y+1, BulkKey());
+    }
+    //A block hanging off the bottom edge writes its bottom cells into a spare row, and does not count them
+    int mask=15;
+    if (bottom==nullptr){
+      this->lookupSpare.resize(width);
+      bottom=this->lookupSpare.data();
+      mask=3;
+    }
+    int key=(columns[-1]<<8)|(columns[0]<<12);
+    int x=0;
+    for (; x+1<width; x+=2){
+      key=(key>>8)|(columns[x+1]<<8)|(columns[x+2]<<12);
+      int next=table[key];
+      top[x]=CELLS[next&1];
+      top[x+1]=CELLS[(next>>1)&1];
+      bottom[x]=CELLS[(next>>2)&1];
+      bottom[x+1]=CELLS[(next>>3)&1];
+      alive+=POPULATION[next&mask];
+    }
+    //A block hanging off the right edge only has its left cells inside the world
+    if (x<width){
+      key=(key>>8)|(columns[x+1]<<8)|(columns[x+2]<<12);
+      int next=table[key];
+      top[x]=CELLS[next&1];
+      bottom[x]=CELLS[(next>>2)&1];
+      alive+=POPULATION[next&mask&5];
+    }
+  }
+  this->newState.set_alive_cells(alive, BulkKey());
+  std::swap(this->currState, this->newState);
+  this->alive_cells=alive;
+  this->dead_cells=this->get_total_cells()-alive;
+}
+
+/**
+ * Vector helpers for Engine::SIMD, wrapping the widest byte vectors the target supports.
+ * LANES is the number of cells handled per instruction, or 0 if the target has no vector support.
+ */
+#if defined(__AVX2__)
+typedef __m256i Lanes;
+static const int LANES=32;
+static inline Lanes lanes_load(const uint8_t* p){ return _mm256_loadu_si256((const __m256i*)p); }
+static inline void lanes_store(void* p, Lanes v){ _mm256_storeu_si256((__m256i*)p, v); }
+static inline Lanes lanes_set(uint8_t b){ return _mm256_set1_epi8((char)b); }
+static inline Lanes lanes_add(Lanes a, Lanes b){ return _mm256_add_epi8(a, b); }
+static inline Lanes lanes_sub(Lanes a, Lanes b){ return _mm256_sub_epi8(a, b); }
+static inline Lanes lanes_eq(Lanes a, Lanes b){ return _mm256_cmpeq_epi8(a, b); }
+static inline Lanes lanes_and(Lanes a, Lanes b){ return _mm256_and_si256(a, b); }
+static inline Lanes lanes_or(Lanes a, Lanes b){ return _mm256_or_si256(a, b); }
+static inline Lanes lanes_andnot(Lanes a, Lanes b){ return _mm256_andnot_si256(a, b); }
+static inline int lanes_count(Lanes mask){ return __builtin_popcount((unsigned)_mm256_movemask_epi8(mask)); }
+#elif defined(__SSE2__)
+typedef __m128i Lanes;
+static const int LANES=16;
+static inline Lanes lanes_load(const uint8_t* p){ return _mm_loadu_si128((const __m128i*)p); }
+static inline void lanes_store(void* p, Lanes v){ _mm_storeu_si128((__m128i*)p, v); }
+static inline Lanes lanes_set(uint8_t b){ return _mm_set1_epi8((char)b); }
+static inline Lanes lanes_add(Lanes a, Lanes b){ return _mm_add_epi8(a, b); }
+static inline Lanes lanes_sub(Lanes a, Lanes b){ return _mm_sub_epi8(a, b); }
+static inline Lanes lanes_eq(Lanes a, Lanes b){ return _mm_cmpeq_epi8(a, b); }
+static inline Lanes lanes_and(Lanes a, Lanes b){ return _mm_and_si128(a, b); }
+static inline Lanes lanes_or(Lanes a, Lanes b){ return _mm_or_si128(a, b); }
+static inline Lanes lanes_andnot(Lanes a, Lanes b){ return _mm_andnot_si128(a, b); }
+static inline int lanes_count(Lanes mask){ return __builtin_popcount((unsigned)_mm_movemask_epi8(mask)); }
+#else
+static const int LANES=0;
+#endif
+
+/**
+ * World::step_simd(toroidal)
+ *
+ * Private helper function to take one step of Engine::SIMD.
+ *
+ * The current state is first normalised into a 0/1 shadow buffer with a one cell border on every side,
+ * holding the wrapped cells on a torus or dead cells otherwise, so the kernel never branches on an edge.
+ * Each row is then computed in two passes of vector instructions: the column sums of the rows above, on,
+ * and below it, then the sums of three neighbouring column sums less the cell itself. The rule is applied
+ * with one vector compare per neighbour count in the rule, and the results are written back as Cell values,
+ * Cell::DEAD plus 3 for each alive cell. Cells left over at the end of a row are computed one at a time.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ */
+
+void World::step_simd(bool toroidal){
+  static_assert(Cell::ALIVE-Cell::DEAD==3, "Alive cells are written as Cell::DEAD plus 3");
+  int height=this->get_height();
+  int width=this->get_width();
+  if (width==0 || height==0){
+    return;
+  }
+  //Normalise the current state into the bordered shadow buffer
+  int stride=width+2;
+  this->simdShadow.assign(stride*(height+2), 0);
+  this->simdColumns.resize(stride);
+  uint8_t* shadow=this->simdShadow.data();
+  for (int y=0; y<height; y++){
+    const Cell* in=this->currState.row(y);
+    uint8_t* out=shadow+(y+1)*stride+1;
+    for (int x=0; x<width; x++){
+      out[x]=(in[x]==Cell::ALIVE);
+    }
+    if (toroidal){
+      out[-1]=out[width-1];
+      out[width]=out[0];
+    }
+  }
+  if (toroidal){
+    std::copy(shadow+height*stride, shadow+(height+1)*stride, shadow);
+    std::copy(shadow+stride, shadow+2*stride, shadow+(height+1)*stride);
+  }
+  int births[9];
+  int survivals[9];
+  int birthCount=0;
+  int survivalCount=0;
+  for (int n=0; n<9; n++){
+    if (this->rule.next(false, n)){
+      births[birthCount++]=n;
+    }
+    if (this->rule.next(true, n)){
+      survivals[survivalCount++]=n;
+    }
+  }
+  uint8_t* columns=this->simdColumns.data();
+  int alive=0;
+  for (int y=0; y<height; y++){
+    const uint8_t* up=shadow+y*stride;
+    const uint8_t* mid=up+stride;
+    const uint8_t* down=mid+stride;
+    Cell* out=this->newState.row_data(y, BulkKey());
+    //Sum each column of the three rows
+    int i=0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    for (; i+LANES<=stride; i+=LANES){
+      lanes_store(columns+i, lanes_add(lanes_add(lanes_load(up+i), lanes_load(mid+i)), lanes_load(down+i)));
+    }
+#endif
+    for (; i<stride; i++){
+      columns[i]=up[i]+mid[i]+down[i];
+    }
+    //Sum three neighbouring columns and apply the rule, cell x of the row is at x+1 in the shadow rows
+    int x=0;
+#if defined(__AVX2__) || defined(__SSE2__)
+    Lanes one=lanes_set(1);
+    Lanes dead=lanes_set(Cell::DEAD);
+    Lanes three=lanes_set(3);
+    for (; x+LANES<=width; x+=LANES){
+      Lanes self=lanes_load(mid+x+1);
+      Lanes count=lanes_sub(lanes_add(lanes_add(lanes_load(columns+x), lanes_load(columns+x+1)),
+                                      lanes_load(columns+x+2)), self);
+      Lanes born=lanes_set(0);
+      for (int b=0; b<birthCount; b++){
+        born=lanes_or(born, lanes_eq(count, lanes_set(births[b])));
+      }
+      Lanes survive=lanes_set(0);
+      for (int s=0; s<survivalCount; s++){
+        survive=lanes_or(survive, lanes_eq(count, lanes_set(survivals[s])));
+      }
+      Lanes isAlive=lanes_eq(self, one);
+      Lanes next=lanes_or(lanes_andnot(isAlive, born), lanes_and(isAlive, survive));
+      lanes_store(out+x, lanes_add(dead, lanes_and(next, three)));
+      alive+=lanes_count(next);
+    }
+#endif
+    for (; x<width; x++){
+      bool self=mid[x+1];
+      int count=columns[x]+columns[x+1]+columns[x+2]-self;
+      bool next=this->rule.next(self, count);
+      out[x]=next ? Cell::ALIVE : Cell::DEAD;
+      alive+=next;
+    }
+  }
+  this->newState.set_alive_cells(alive, BulkKey());
+  std::swap(this->currState, this->newState);
+  this->alive_cells=alive;
+  this->dead_cells=this->get_total_cells()-alive;
+}
+
+/**
+ * World::step_temporal(generations, toroidal)
+ *
+ * Private helper function to advance Engine::TEMPORAL a number of generations in one pass over the grid.
+ *
+ * The world is split into World::TILE_SIZE square tiles. Each tile is copied into a buffer of 0/1 bytes together with
+ * a halo the width of the number of generations, the halo holding the wrapped cells on a torus, or dead cells
+ * beyond a bounded edge. The buffer is then stepped generation by generation. A cell's next value only depends on
+ * its neighbours, so each generation computes a region one cell smaller on every side than the last, and after the
+ * last generation exactly the tile itself is left correct. Halos of neighbouring tiles overlap, recomputing a few
+ * cells twice, but the grid is only read and written once for all the generations.
+ *
+ * In a bounded world the halo cells beyond the edge are cleared again after every generation, as the world is
+ * Cell::DEAD outside its bounds no matter what the rule would do there. On a torus smaller than the halo the same
+ * cell can be copied into the buffer more than once, which is still correct.
+ *
+ * @param generations
+ *      The number of generations to advance, at least 1.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ */
+
+void World::step_temporal(int generations, bool toroidal){
+  this->generation+=generations;
+  this->toroidal=toroidal;
+  int width=this->get_width();
+  int height=this->get_height();
+  if (width==0 || height==0){
+    return;
+  }
+  //Every tile of the next state is overwritten, so cells shared with a state returned by World::get_state are not copied
+  this->newState.renew(BulkKey());
+  int k=generations;
+  int span=TILE_SIZE+2*k;
+  this->blockCells.resize(span*span);
+  this->blockNext.resize(span*span);
+  this->blockColumns.resize(span);
+  this->blockSums.resize(span);
+  uint32_t rule=this->rule.packed();
+  int alive=0;
+  for (int y0=0; y0<height; y0+=TILE_SIZE){
+    for (int x0=0; x0<width; x0+=TILE_SIZE){
+      int x1=std::min(x0+TILE_SIZE, width);
+      int y1=std::min(y0+TILE_SIZE, height);
+      int w=x1-x0+2*k;
+      int h=y1-y0+2*k;
+      uint8_t* cells=this->blockCells.data();
+      uint8_t* next=this->blockNext.data();
+      //The world column of each buffer column, or -1 beyond a bounded edge
+      int* columns=this->blockColumns.data();
+      uint8_t* sums=this->blockSums.data();
+      for (int bx=0; bx<w; bx++){
+        int x=x0-k+bx;
+        if (x<0 || x>=width){
+          x=toroidal ? ((x%width)+width)%width : -1;
+        }
+        columns[bx]=x;
+      }
+      //Copy the tile and its halo into the buffer
+      for (int by=0; by<h; by++){
+        int y=y0-k+by;
+        if (y<0 || y>=height){
+          y=toroidal ? ((y%height)+height)%height : -1;
+        }
+        uint8_t* out=cells+by*w;
+        if (y<0){
+          std::fill(out, out+w, 0);
+          continue;
+        }
+        const Cell* in=this->currState.row(y);
+        for (int bx=0; bx<w; bx++){
+          out[bx]=(columns[bx]>=0 && in[columns[bx]]==Cell::ALIVE);
+        }
+      }
+      //Step the buffer, the correct region shrinking by one cell on every side per generation
+      for (int g=1; g<=k; g++){
+        for (int by=g; by<h-g; by++){
+          int y=y0-k+by;
+          uint8_t* out=next+by*w;
+          if (!toroidal && (y<0 || y>=height)){
+            std::fill(out+g, out+w-g, 0);
+            continue;
+          }
+          const uint8_t* up=cells+(by-1)*w;
+          const uint8_t* mid=up+w;
+          const uint8_t* down=mid+w;
+          sum_columns(up, mid, down, sums, g-1, w-g+1);
+          step_columns(sums, mid, out, g, w-g, rule);
+          if (!toroidal){
+            for (int bx=g; bx<w-g; bx++){
+              out[bx]&=(columns[bx]>=0);
+            }
+          }
+        }
+        std::swap(cells, next);
+      }
+      //Write the centre of the buffer back as the tile of the next state
+      for (int y=y0; y<y1; y++){
+        const uint8_t* in=cells+(y-y0+k)*w+k;
+        Cell* out=this->newState.row_data(y, BulkKey());
+        for (int x=x0; x<x1; x++){
+          out[x]=in[x-x0] ? Cell::ALIVE : Cell::DEAD;
+          alive+=in[x-x0];
+        }
+      }
+    }
+  }
+  this->newState.set_alive_cells(alive, BulkKey());
+  std::swap(this->currState, this->newState);
+  this->alive_cells=alive;
+  this->dead_cells=this->get_total_cells()-alive;
+}
+
+/**
+ * World::advance_hashlife(steps, toroidal)
+ *
+ * Private helper function to advance Engine::HASHLIFE any number of generations in one call.
+ * The alive and dead counts are those of the window of the plane covered by the world.
+ * As with every other engine, a count of 0 or less leaves the world as it is.
+ *
+ * @param steps
+ *      The number of steps to advance the world forward.
+ *
+ * @param toroidal
+ *      Must be false, a HashLife plane has no edges to wrap.
+ *
+ * @throws
+ *      std::runtime_error if toroidal is true.
+ */
+
+void World::advance_hashlife(int steps, bool toroidal){
+  if (steps<=0){
+    return;
+  }
+  if (toroidal){
+    throw std::runtime_error("The HashLife engine does not support toroidal worlds");
+  }
+  this->life.advance(steps);
+  this->generation+=steps;
+  this->toroidal=false;
+  this->alive_cells=this->life.count_alive(0, 0, this->width, this->height);
+  this->dead_cells=this->get_total_cells()-this->alive_cells;
+}
+
+/**
+ * World::step(toroidal)
+ *
+ * Take one step in Conway's Game of Life.
+ *
+ * Reads from the current state grid and writes to the next state grid. Then swaps the grids.
+ * Should be implemented by invoking World::count_neighbours(x, y) after World::fill_halo(toroidal).
+ * Swapping the grids should be done in O(1) constant time, and should not invoke a copy.
+ * Try and boil the logic down to the fewest and most simple conditional statements.
+ *
+ * Rules: https://en.wikipedia.org/wiki/Conway%27s_Game_of_Life
+ *      - Any live cell with fewer than two live neighbours dies, as if by underpopulation.
+ *      - Any live cell with two or three live neighbours lives on to the next generation.
+ *      - Any live cell with more than three live neighbours dies, as if by overpopulation.
+ *      - Any dead cell with exactly three live neighbours becomes a live cell, as if by reproduction.
+ *
+ * These are the default rule, B3/S23. World::set_rule switches to any other outer-totalistic rule.
+ *
+ * If the world tracks changes, the cells born and died in the step are listed in World::get_changes.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ */
+
+void World::step(bool toroidal){
+  if (!this->trackChanges){
+    this->step_engine(toroidal);
+  }
+  else if (this->engine==Engine::HASHLIFE){
+    //A HashLife plane keeps no previous generation to compare with, so keep a copy of the window
+    Grid before=this->get_state();
+    this->changes.clear();
+    this->step_engine(toroidal);
+    this->diff_state(before);
+  }
+  else{
+    this->changes.clear();
+    this->step_engine(toroidal);
+    //These kernels work on blocks and vectors of cells, so compare with the previous generation they left behind
+    if (this->engine==Engine::LOOKUP || this->engine==Engine::SIMD || this->engine==Engine::TEMPORAL){
+      this->diff_state(this->newState);
+    }
+  }
+  this->record_history();
+}
+
+void World::step(){
+  this->step(false);
+}
+
+/**
+ * World::step_engine(toroidal)
+ *
+ * Private helper function to take one step with the current engine, without recording it in the history.
+ *
+ * @param toroidal
+ *      If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom.
+ */
+
+void World::step_engine(bool toroidal){
+  if (this->engine==Engine::HASHLIFE){
+    this->advance_hashlife(1, toroidal);
+    return;
+  }
+  if (this->engine==Engine::TEMPORAL){
+    this->step_temporal(1, toroidal);
+    return;
+  }
+  //A state returned by World::get_state may still share the cells the step writes, so they are made the
+  //world's own first. Engine::TILED leaves quiet tiles as they were, every other engine overwrites every cell.
+  if (this->engine==Engine::TILED){
+    this->newState.detach(BulkKey());
+  }
+  else{
+    this->newState.renew(BulkKey());
+  }
+  this->generation++;
+  this->toroidal=toroidal;
+  if (this->engine==Engine::BITWISE){
+    this->step_bitwise(toroidal);
+    return;
+  }
+  if (this->engine==Engine::PARALLEL){
+    this->step_parallel(toroidal);
+    return;
+  }
+  if (this->engine==Engine::TILED){
+    this->step_tiled(toroidal);
+    return;
+  }
+  if (this->engine==Engine::LOOKUP){
+    this->step_lookup(toroidal);
+    return;
+  }
+  if (this->engine==Engine::SIMD){
+    this->step_simd(toroidal);
+    return;
+  }
+  if (this->engine==Engine::WINDOW){
+    int alive=this->step_rows(0, this->get_height(), toroidal, this->trackChanges ? &this->changes : nullptr);
+    this->newState.set_alive_cells(alive, BulkKey());
+    std::swap(this->currState, this->newState);
+    this->alive_cells=alive;
+    this->dead_cells=this->get_total_cells()-alive;
+    return;
+  }
+  this->fill_halo(toroidal);
+  int height=this->get_height();
+  int width=this->get_width();
+  int stride=width+2;
+  int count;
+  int alive=0;
+  for (int h=0; h<height; h++){
+    const Cell* in=this->currHalo.data()+(h+1)*stride+1;
+    Cell* out=this->newHalo.data()+(h+1)*stride+1;
+    for (int w=0; w<width; w++){
+      count=this->count_neighbours(w, h);
+      //Look the next value of the cell up in the rule's transition table
+      bool next=this->rule.next(in[w]==Cell::ALIVE, count);
+      out[w]=next ? Cell::ALIVE : Cell::DEAD;
+      alive+=next;
+      if (this->trackChanges && out[w]!=in[w]){
+        this->changes.push_back(Change{w, h, next});
+      }
+    }
+  }
+  std::swap(this->currHalo, this->newHalo);
+  this->alive_cells=alive;
+  this->dead_cells=this->get_total_cells()-alive;
+}
+
+/**
+ * World::advance(steps, toroidal)
+ *
+ * Advance multiple steps in the Game of Life.
+ * Should be implemented by invoking World::step(toroidal).
+ * Engine::HASHLIFE instead advances all the steps at once, skipping a power of two generations at a time.
+ * Engine::TEMPORAL instead advances World::TEMPORAL_DEPTH steps per pass over the grid.
+ * While the world keeps a history or tracks changes, every engine steps one generation at a time instead,
+ * so each generation is recorded and World::get_changes holds the changes of the last one.
+ *
+ * @param steps
+ *      The number of steps to advance the world forward.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ */
+
+void World::advance(int steps, bool toroidal){
+  if (this->history.get_budget()>0 || this->trackChanges){
+    for (int i=0; i<steps; i++){
+      this->step(toroidal);
+    }
+    return;
+  }
+  if (this->engine==Engine::HASHLIFE){
+    this->advance_hashlife(steps, toroidal);
+    return;
+  }
+  if (this->engine==Engine::TEMPORAL){
+    for (int done=0; done<steps; done+=TEMPORAL_DEPTH){
+      this->step_temporal(std::min(TEMPORAL_DEPTH, steps-done), toroidal);
+    }
+    return;
   }
-}
-
-void World::advance(int steps){
   for (int i=0; i<steps; i++){
-    this->step(false);
+    this->step(toroidal);
   }
 }
+
+void World::advance(int steps){
+  this->advance(steps, false);
+}
+
+/**
+ * hash_bytes(hash, data, length)
+ *
+ * Mixes bytes into a running 64-bit hash, 8 bytes at a time with a multiply and rotate.
+ *
+ * @param hash
+ *      The hash so far.
+ *
+ * @param data
+ *      The bytes to mix in.
+ *
+ * @param length
+ *      The number of bytes.
+ *
+ * @return
+ *      The updated hash.
+ */
+
+static uint64_t hash_bytes(uint64_t hash, const void* data, size_t length){
+  const unsigned char* bytes=(const unsigned char*)data;
+  size_t i=0;
+  for (; i+8<=length; i+=8){
+    uint64_t word;
+    std::memcpy(&word, bytes+i, 8);
+    hash=(hash^word)*0x9E3779B97F4A7C15ULL;
+    hash^=hash>>29;
+  }
+  for (; i<length; i++){
+    hash=(hash^bytes[i])*0x100000001B3ULL;
+  }
+  return hash^(hash>>32);
+}
+
+/**
+ * World::snapshot()
+ *
+ * Private helper function to copy the world for World::advance_until_stable to step on its own. The copy shares
+ * the cells of the world until either of them writes, and keeps no history and tracks no changes, so stepping it
+ * costs no more than stepping the world.
+ *
+ * @return
+ *      A copy of the world at its current generation.
+ */
+
+World World::snapshot(){
+  //The history is set aside rather than copied, as it can hold far more than the world itself
+  History kept=std::move(this->history);
+  this->history=History();
+  World copy(*this);
+  this->history=std::move(kept);
+  copy.trackChanges=false;
+  copy.changes.clear();
+  copy.bandChanges.clear();
+  return copy;
+}
+
+/**
+ * World::advance_until_stable(max_steps, toroidal)
+ *
+ * Advance step by step until the world repeats a recent generation, or max_steps steps have been taken.
+ *
+ * Each generation is bit-packed with World::pack_state, and only the 64-bit hash of the packed cells is remembered,
+ * for the last World::CYCLE_HISTORY generations. A copy of the world is also saved every World::CYCLE_HISTORY
+ * generations, keeping the last two, so every remembered generation is at most 2 * World::CYCLE_HISTORY steps after
+ * a saved one. When a new generation hashes to the same value as a remembered one, a copy of the nearest saved world
+ * at or before the remembered generation is stepped up to it and compared with the new one byte by byte, so a hash
+ * collision can never stop the world early. Matches are rare, so the replay costs little, and the memory used is two
+ * copies of the world however long the search runs. The world is left at the first repeated generation,
+ * first + period steps after the call, so a caller wanting generation N can skip ahead by advancing only
+ * (N - first - period) % period more steps.
+ *
+ * Still lifes and empty worlds are cycles with a period of 1. Cycles longer than World::CYCLE_HISTORY are not found.
+ *
+ * @example
+ *
+ *      // Set a glider crossing a 16x16 torus
+ *      Grid grid(16, 16);
+ *      grid.merge(Zoo::glider(), 0, 0);
+ *      World world(grid);
+ *      Cycle cycle = world.advance_until_stable(1000, true);
+ *
+ *      // Prints 64, the glider moves one cell diagonally every 4 generations
+ *      std::cout << cycle.period << std::endl;
+ *
+ * @param max_steps
+ *      The most steps to advance the world forward.
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *
+ * @return
+ *      The period and first generation of the cycle, counted from the start of the call.
+ *      The period is 0 and the first generation -1 if no cycle was found in max_steps steps.
+ */
+
+Cycle World::advance_until_stable(int max_steps, bool toroidal){
+  std::unordered_map<uint64_t, int> seen;
+  std::vector<uint64_t> recent(CYCLE_HISTORY);
+  std::vector<uint8_t> packed;
+  std::vector<uint8_t> earlier;
+  //The world at the last two multiples of World::CYCLE_HISTORY generations, the older at or before every
+  //generation whose hash is remembered
+  World saved[2]={this->snapshot(), World()};
+  int savedAt[2]={0, -1};
+  this->pack_state(packed);
+  const uint64_t seed=0xCBF29CE484222325ULL;
+  uint64_t hash=hash_bytes(seed, packed.data(), packed.size());
+  seen[hash]=0;
+  recent[0]=hash;
+  for (int generation=1; generation<=max_steps; generation++){
+    this->step(toroidal);
+    this->pack_state(packed);
+    hash=hash_bytes(seed, packed.data(), packed.size());
+    auto found=seen.find(hash);
+    if (found!=seen.end()){
+      int first=found->second;
+      //Replay from the later saved world unless it is past the remembered generation
+      int nearest=((savedAt[1]<=first && savedAt[1]>savedAt[0]) || savedAt[0]>first) ? 1 : 0;
+      World check(saved[nearest]);
+      check.advance(first-savedAt[nearest], toroidal);
+      check.pack_state(earlier);
+      if (earlier==packed){
+        return Cycle{generation-first, first};
+      }
+    }
+    //Forget the generation falling out of the history, unless a later generation had the same hash
+    int slot=generation%CYCLE_HISTORY;
+    if (generation>=CYCLE_HISTORY){
+      auto old=seen.find(recent[slot]);
+      if (old!=seen.end() && old->second==generation-CYCLE_HISTORY){
+        seen.erase(old);
+      }
+    }
+    seen[hash]=generation;
+    recent[slot]=hash;
+    if (slot==0){
+      int older=(savedAt[0]<savedAt[1]) ? 0 : 1;
+      saved[older]=this->snapshot();
+      savedAt[older]=generation;
+    }
+  }
+  return Cycle{0, -1};
+}
+
+Cycle World::advance_until_stable(int max_steps){
+  return this->advance_until_stable(max_steps, false);
+}
+
+/**
+ * Checkpoints are a fixed little endian header followed by the cells, so they read back on any machine.
+ *      - Bytes 0 to 3 hold World::CHECKPOINT_MAGIC and byte 4 World::CHECKPOINT_VERSION.
+ *      - Byte 5 holds flags, bit 0 set if the world was last stepped as a torus.
+ *      - Bytes 6 to 9 hold the birth and survival masks of the rule, 2 bytes each.
+ *      - Bytes 10 to 17 hold the width and height, 4 bytes each.
+ *      - Bytes 18 to 25 hold the generation.
+ *      - Each row follows, 8 cells per byte with the leftmost cell in the lowest bit, padded to a whole byte.
+ */
+static const int CHECKPOINT_HEADER=26;
+static const size_t CHECKPOINT_CHUNK=1<<20;
+
+/**
+ * put_bytes(out, value, bytes)
+ *
+ * Writes the lowest bytes of a value to a buffer, lowest byte first.
+ */
+
+static void put_bytes(uint8_t* out, uint64_t value, int bytes){
+  for (int i=0; i<bytes; i++){
+    out[i]=(uint8_t)(value>>(8*i));
+  }
+}
+
+/**
+ * get_bytes(in, bytes)
+ *
+ * Reads a value written by put_bytes.
+ */
+
+static uint64_t get_bytes(const uint8_t* in, int bytes){
+  uint64_t value=0;
+  for (int i=0; i<bytes; i++){
+    value|=(uint64_t)in[i]<<(8*i);
+  }
+  return value;
+}
+
+/**
+ * pack_cells(cells, width, packed)
+ *
+ * Packs a row of cells into bits, 8 cells per byte with the leftmost cell in the lowest bit.
+ * Cell::ALIVE is odd and Cell::DEAD even, so whole groups of 8 cells are packed by gathering the lowest bit
+ * of each of their bytes with one multiply.
+ */
+
+static void pack_cells(const Cell* cells, int width, uint8_t* packed){
+  static_assert((Cell::ALIVE&1)==1 && (Cell::DEAD&1)==0, "Cells are packed by their lowest bit");
+  int x=0;
+  for (; x+8<=width; x+=8){
+    //Byte b holds the cell in bit 0, and the multiply moves it to bit 56 + b
+    uint64_t word=get_bytes((const uint8_t*)(cells+x), 8);
+    packed[x/8]=(uint8_t)(((word&0x0101010101010101ULL)*0x0102040810204080ULL)>>56);
+  }
+  for (; x<width; x+=8){
+    int n=std::min(8, width-x);
+    uint8_t byte=0;
+    for (int b=0; b<n; b++){
+      byte|=(uint8_t)(cells[x+b]==Cell::ALIVE)<<b;
+    }
+    packed[x/8]=byte;
+  }
+}
+
+/**
+ * World::unpack_state(packed, width, height)
+ *
+ * Private helper function to unpack a state bit-packed by World::pack_state into a Grid,
+ * counting its alive cells as it goes.
+ */
+
+Grid World::unpack_state(const uint8_t* packed, int width, int height){
+  Grid state(width, height);
+  int rowBytes=(width+7)/8;
+  int alive=0;
+  for (int y=0; y<height; y++){
+    const uint8_t* bits=packed+(size_t)y*rowBytes;
+    Cell* row=state.row_data(y, BulkKey());
+    for (int x=0; x<width; x++){
+      bool bit=(bits[x/8]>>(x%8))&1;
+      row[x]=bit ? Cell::ALIVE : Cell::DEAD;
+      alive+=bit;
+    }
+  }
+  state.set_alive_cells(alive, BulkKey());
+  return state;
+}
+
+/**
+ * World::pack_state(packed)
+ *
+ * Private helper function to bit-pack the current state, straight from the buffers of the current engine.
+ * Each row is 8 cells per byte with the leftmost cell in the lowest bit, padded to a whole byte.
+ * Engine::BITWISE rows are already bit-packed in the same order, so they are copied a byte at a time.
+ * Only Engine::HASHLIFE, whose cells live in a quadtree, is converted with World::get_state.
+ *
+ * @param packed
+ *      Resized to hold the packed rows, one after another, and filled with them.
+ */
+
+void World::pack_state(std::vector<uint8_t>& packed) const{
+  Grid state;
+  if (this->engine==Engine::HASHLIFE){
+    state=this->get_state();
+  }
+  int rowBytes=(this->width+7)/8;
+  packed.resize((size_t)rowBytes*this->height);
+  for (int y=0; y<this->height; y++){
+    uint8_t* out=packed.data()+(size_t)y*rowBytes;
+    if (this->engine==Engine::BITWISE){
+      const uint64_t* words=this->currBits.row(y);
+      for (int i=0; i<rowBytes; i++){
+        out[i]=(uint8_t)(words[i/8]>>(8*(i%8)));
+      }
+    }
+    else if (this->engine==Engine::NAIVE){
+      pack_cells(this->currHalo.data()+(y+1)*(this->width+2)+1, this->width, out);
+    }
+    else if (this->engine==Engine::HASHLIFE){
+      pack_cells(state.row(y), this->width, out);
+    }
+    else{
+      pack_cells(this->currState.row(y), this->width, out);
+    }
+  }
+}
+
+/**
+ * World::checkpoint(stream)
+ *
+ * Write the current generation, generation number, topology and rule to a stream in the bit-packed checkpoint
+ * format, so a long run can later carry on from this point with World::restore.
+ *
+ * The cells are packed straight from the buffers of the current engine with World::pack_state, without copying
+ * the state into a Grid first.
+ *
+ * @example
+ *
+ *      // Serialise a world in memory, to be written out later
+ *      std::ostringstream buffer;
+ *      world.checkpoint(buffer);
+ *
+ * @param stream
+ *      The stream to write to, which should be opened in binary mode.
+ *
+ * @throws
+ *      std::runtime_error if the stream fails.
+ */
+
+void World::checkpoint(std::ostream& stream) const{
+  uint8_t header[CHECKPOINT_HEADER];
+  put_bytes(header, CHECKPOINT_MAGIC, 4);
+  put_bytes(header+4, CHECKPOINT_VERSION, 1);
+  put_bytes(header+5, this->toroidal ? 1 : 0, 1);
+  put_bytes(header+6, this->rule.get_birth(), 2);
+  put_bytes(header+8, this->rule.get_survival(), 2);
+  put_bytes(header+10, (uint32_t)this->width, 4);
+  put_bytes(header+14, (uint32_t)this->height, 4);
+  put_bytes(header+18, (uint64_t)this->generation, 8);
+  stream.write((const char*)header, CHECKPOINT_HEADER);
+
+  std::vector<uint8_t> packed;
+  this->pack_state(packed);
+  stream.write((const char*)packed.data(), packed.size());
+  if (!stream){
+    throw std::runtime_error("Could not write the checkpoint");
+  }
+}
+
+/**
+ * World::checkpoint(path)
+ *
+ * Write a checkpoint of the world to a file, as World::checkpoint(stream).
+ *
+ * @example
+ *
+ *      // Save a world part way through a long run
+ *      world.advance(1000000);
+ *      world.checkpoint("run.ckpt");
+ *
+ * @param path
+ *      The std::string path to the file to write to.
+ *
+ * @throws
+ *      std::runtime_error if the file cannot be opened or written.
+ */
+
+void World::checkpoint(std::string path) const{
+  std::ofstream file(path, std::ios::binary);
+  if (!file){
+    throw std::runtime_error("Could not open the checkpoint file "+path);
+  }
+  this->checkpoint(file);
+  file.close();
+  if (!file){
+    throw std::runtime_error("Could not write the checkpoint file "+path);
+  }
+}
+
+/**
+ * World::restore(stream)
+ *
+ * Replace the state, size, rule, generation number and topology of the world with a checkpoint read from a stream.
+ * The world keeps its engine, and the cells are unpacked into the buffers of that engine.
+ * Nothing about the world changes if the checkpoint cannot be read.
+ *
+ * @example
+ *
+ *      // Carry on a run from the generation it was saved at
+ *      World world;
+ *      std::ifstream file("run.ckpt", std::ios::binary);
+ *      world.restore(file);
+ *      world.advance(steps - world.get_generation(), world.get_toroidal());
+ *
+ * @param stream
+ *      The stream to read from, which should be opened in binary mode.
+ *
+ * @throws
+ *      std::runtime_error if:
+ *          - The stream does not hold a checkpoint of a supported version.
+ *          - The stream ends unexpectedly.
+ *          - The size in the header is too large for a Grid.
+ *          - The engine is Engine::HASHLIFE and the rule gives birth with 0 neighbours.
+ */
+
+void World::restore(std::istream& stream){
+  uint8_t header[CHECKPOINT_HEADER];
+  if (!stream.read((char*)header, CHECKPOINT_HEADER)){
+    throw std::runtime_error("The checkpoint ends unexpectedly");
+  }
+  if (get_bytes(header, 4)!=CHECKPOINT_MAGIC){
+    throw std::runtime_error("Not a world checkpoint");
+  }
+  if ((int)get_bytes(header+4, 1)!=CHECKPOINT_VERSION){
+    throw std::runtime_error("Unsupported checkpoint version "+std::to_string(get_bytes(header+4, 1)));
+  }
+  bool toroidal=get_bytes(header+5, 1)&1;
+  Rule rule((uint16_t)get_bytes(header+6, 2), (uint16_t)get_bytes(header+8, 2));
+  int width=(int32_t)get_bytes(header+10, 4);
+  int height=(int32_t)get_bytes(header+14, 4);
+  int64_t generation=(int64_t)get_bytes(header+18, 8);
+  if (width<0 || height<0){
+    throw std::runtime_error("The checkpoint has a negative size");
+  }
+  if (this->engine==Engine::HASHLIFE && rule.next(false, 0)){
+    throw std::runtime_error("HashLife cannot run rules with B0 on an unbounded plane");
+  }
+
+  //A Grid counts its cells in an int, so a header claiming more cannot be a checkpoint of one
+  if ((size_t)width*(size_t)height>(size_t)std::numeric_limits<int>::max()){
+    throw std::runtime_error("The checkpoint is too large for a world");
+  }
+
+  //Read the cells a chunk at a time, so a header claiming more cells than follow it fails before they are allocated
+  size_t bytes=((size_t)width+7)/8*(size_t)height;
+  std::vector<uint8_t> packed;
+  while (packed.size()<bytes){
+    size_t start=packed.size();
+    packed.resize(std::min(bytes, start+CHECKPOINT_CHUNK));
+    if (!stream.read((char*)packed.data()+start, packed.size()-start)){
+      throw std::runtime_error("The checkpoint ends unexpectedly");
+    }
+  }
+  Grid state=unpack_state(packed.data(), width, height);
+
+  this->rule=rule;
+  this->load_state(state);
+  this->generation=generation;
+  this->toroidal=toroidal;
+  this->history.clear();
+  this->changes.clear();
+  this->record_history();
+}
+
+/**
+ * World::restore(path)
+ *
+ * Replace the world with a checkpoint read from a file, as World::restore(stream).
+ *
+ * @example
+ *
+ *      // Carry on a run from the generation it was saved at
+ *      World world;
+ *      world.restore("run.ckpt");
+ *
+ * @param path
+ *      The std::string path to the file to read in.
+ *
+ * @throws
+ *      std::runtime_error if the file cannot be opened, or for any reason World::restore(stream) throws.
+ */
+
+void World::restore(std::string path){
+  std::ifstream file(path, std::ios::binary);
+  if (!file){
+    throw std::runtime_error("Could not open the checkpoint file "+path);
+  }
+  this->restore(file);
+}
+
+/**
+ * World::record_history()
+ *
+ * Private helper function to record the current generation in the history, if the world keeps one.
+ */
+
+void World::record_history(){
+  if (this->history.get_budget()==0){
+    return;
+  }
+  this->pack_state(this->historyPacked);
+  this->history.record(this->generation, this->historyPacked.data(), this->historyPacked.size());
+}
+
+/**
+ * World::set_history(budget, interval)
+ *
+ * Start keeping a history of the generations of the world from the current one onwards, so it can be stepped
+ * backwards with World::rewind or looked back on with World::state_at without simulating it again.
+ *
+ * Each generation is stored as a sparse XOR delta from the one before it, with a sparse keyframe of the whole
+ * state every interval generations. Once the frames use more than budget bytes the oldest keyframes are forgotten,
+ * so the number of generations kept depends on how much the world changes rather than being fixed.
+ * While the history is kept, World::advance steps every engine one generation at a time to record each one.
+ *
+ * @example
+ *
+ *      // Remember as many generations as fit in 64MB
+ *      World world(grid);
+ *      world.set_history(64 << 20);
+ *      world.advance(1000);
+ *
+ *      // Step back to generation 900
+ *      world.rewind(100);
+ *
+ * @param budget
+ *      The most bytes of history to keep. 0 stops keeping a history and forgets it.
+ *
+ * @param interval
+ *      Optional parameter. The number of generations between keyframes. Shorter intervals make recalling a
+ *      generation faster, longer ones fit more generations in the budget. Defaults to World::HISTORY_INTERVAL.
+ */
+
+void World::set_history(size_t budget, int interval){
+  this->history=History(budget, interval);
+  this->record_history();
+}
+
+void World::set_history(size_t budget){
+  this->set_history(budget, HISTORY_INTERVAL);
+}
+
+/**
+ * World::get_history_used()
+ *
+ * Gets the number of bytes the history uses, at most the budget given to World::set_history.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The bytes used.
+ */
+
+size_t World::get_history_used() const{
+  return this->history.get_used();
+}
+
+/**
+ * World::get_history_first()
+ *
+ * Gets the oldest generation still in the history. Every generation from it to World::get_generation() is kept.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The oldest generation, or -1 if the world keeps no history.
+ */
+
+int64_t World::get_history_first() const{
+  return this->history.get_first();
+}
+
+/**
+ * World::state_at(generation)
+ *
+ * Rebuild an earlier generation of the world from the history, leaving the world as it is.
+ * The function should be callable from a constant context.
+ *
+ * @example
+ *
+ *      // Print how the world looked 10 generations ago
+ *      std::cout << world.state_at(world.get_generation() - 10) << std::endl;
+ *
+ * @param generation
+ *      The generation, from World::get_history_first() to World::get_generation().
+ *
+ * @return
+ *      The state of the world at that generation.
+ *
+ * @throws
+ *      std::runtime_error if the generation is not in the history.
+ */
+
+Grid World::state_at(int64_t generation) const{
+  std::vector<uint8_t> packed;
+  this->history.state_at(generation, packed);
+  return unpack_state(packed.data(), this->width, this->height);
+}
+
+/**
+ * World::rewind(steps)
+ *
+ * Step the world backwards in time to an earlier generation in the history. The generations after it are
+ * forgotten, so stepping forwards again records the new timeline in their place.
+ * With Engine::HASHLIFE only the cells inside the world are remembered, not the rest of the plane.
+ *
+ * @example
+ *
+ *      // Undo the last step
+ *      world.rewind(1);
+ *
+ * @param steps
+ *      The number of generations to step backwards.
+ *
+ * @throws
+ *      std::runtime_error if the generation is not in the history.
+ */
+
+void World::rewind(int steps){
+  int64_t target=this->generation-steps;
+  Grid state=this->state_at(target);
+  this->load_state(state);
+  this->generation=target;
+  this->history.truncate(target);
+  this->changes.clear();
+}
+
+/**
+ * World::get_track_changes()
+ *
+ * Gets whether the world lists the cells born and died in each step.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      True if changes are tracked.
+ */
+
+bool World::get_track_changes() const{
+  return this->trackChanges;
+}
+
+/**
+ * World::set_track_changes(track)
+ *
+ * Start or stop listing the cells born and died in each step, so renderers, trackers and loggers can do work
+ * in proportion to what changed rather than comparing whole generations.
+ *
+ * Engine::NAIVE, Engine::BITWISE, Engine::WINDOW, Engine::PARALLEL and Engine::TILED list the changes in their
+ * kernels as they step, Engine::BITWISE 64 cells per comparison and Engine::TILED only in the tiles it computes.
+ * Engine::LOOKUP, Engine::SIMD and Engine::TEMPORAL compare the new generation with the previous one they leave
+ * in the next state buffer, 8 cells per comparison. Engine::HASHLIFE compares with a copy taken before the step.
+ *
+ * @example
+ *
+ *      // Only redraw the cells that changed
+ *      world.set_track_changes(true);
+ *      world.step();
+ *      for (const Change& change : world.get_changes()) {
+ *          draw(change.x, change.y, change.born);
+ *      }
+ *
+ * @param track
+ *      True to list the changes of each step from now on, false to stop.
+ */
+
+void World::set_track_changes(bool track){
+  this->trackChanges=track;
+  this->changes.clear();
+  this->bandChanges.clear();
+}
+
+/**
+ * World::get_changes()
+ *
+ * Gets the cells born and died in the last step, grouped by row. Engine::TILED groups them by tile first.
+ * The list is reused by the next step, so copy it to keep it.
+ * The function should be callable from a constant context.
+ *
+ * @return
+ *      The changes of the last step, or an empty list if changes are not tracked.
+ */
+
+const std::vector<Change>& World::get_changes() const{
+  return this->changes;
+}
+
+/**
+ * World::view_state()
+ *
+ * Private helper function to get a read only reference to the current state without copying it where possible.
+ * Engines stepping a Grid return it directly. Engine::NAIVE, Engine::BITWISE and Engine::HASHLIFE store their cells
+ * differently, so their state is converted into a Grid kept by the world. The conversion overwrites the cells of
+ * that Grid in place, so viewing every generation allocates nothing unless the size changes or a copy of the last
+ * view is still held.
+ *
+ * @return
+ *      The current state, valid until the world is next stepped or changed.
+ */
+
+const Grid& World::view_state(){
+  if (this->engine!=Engine::NAIVE && this->engine!=Engine::BITWISE && this->engine!=Engine::HASHLIFE){
+    return this->currState;
+  }
+  if (this->viewState.get_width()!=this->width || this->viewState.get_height()!=this->height){
+    this->viewState=Grid(this->width, this->height);
+  }
+  if (this->engine==Engine::BITWISE){
+    this->currBits.to_grid(this->viewState);
+  }
+  else if (this->engine==Engine::HASHLIFE){
+    this->life.to_grid(0, 0, this->viewState);
+  }
+  else{
+    this->viewState.renew(BulkKey());
+    for (int y=0; y<this->height; y++){
+      const Cell* row=this->currHalo.data()+(y+1)*(this->width+2)+1;
+      std::copy(row, row+this->width, this->viewState.row_data(y, BulkKey()));
+    }
+    this->viewState.set_alive_cells(this->alive_cells, BulkKey());
+  }
+  return this->viewState;
+}
+
+#if defined(__cpp_impl_coroutine)
+/**
+ * World::generations(toroidal)
+ *
+ * A lazy, endless sequence of the generations of the world, starting with the current state.
+ *
+ * Each generation is only computed when it is read, or compared against the end of the sequence, after the sequence
+ * is advanced, so a consumer that stops early never pays for the generations it did not look at. Each generation is
+ * a read only reference to the state of the world itself rather than a copy, valid until the sequence is advanced.
+ * Reading the next generation steps the world, so after visiting generations 0 to n-1 with std::views::take(n) the
+ * world has been stepped n-1 times and is left at the last generation visited.
+ *
+ * @example
+ *
+ *      // Print the population of the first 100 generations without copying any of them
+ *      for (const Grid& generation : world.generations(true) | std::views::take(100)) {
+ *          std::cout << generation.get_alive_cells() << std::endl;
+ *      }
+ *
+ * @param toroidal
+ *      Optional parameter. If true then the step will consider the grid as a torus, where the left edge
+ *      wraps to the right edge and the top to the bottom. Defaults to false.
+ *
+ * @return
+ *      A generator yielding each generation in turn. The world must outlive it.
+ */
+
+Generator<const Grid&> World::generations(bool toroidal){
+  while (true){
+    co_yield this->view_state();
+    this->step(toroidal);
+  }
+}
+
+Generator<const Grid&> World::generations(){
+  return this->generations(false);
+}
+#endif
@@ -11,14 +11,78 @@
 #pragma once
 
 #include "grid.h"
+#include "bitgrid.h"
+#include "threadpool.h"
+#include "hashlife.h"
+#include "rule.h"
+#include "history.h"
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+#if defined(__cpp_impl_coroutine)
+#include "generator.h"
+#endif
 // Add the minimal number of includes you need in order to declare the class.
 // #include ...
 
+/**
+ * An Engine selects how a World stores its cells and computes the next generation.
+ *      - Engine::NAIVE counts the neighbours of each Cell in a Grid one at a time.
+ *      - Engine::BITWISE packs 64 cells into each word and steps a whole word at once.
+ *      - Engine::WINDOW reads the Grid rows in place and slides a three row window along them.
+ *      - Engine::PARALLEL runs the Engine::WINDOW kernel on horizontal bands across a thread pool.
+ *      - Engine::HASHLIFE advances a HashLife quadtree, skipping a power of two generations at a time.
+ *      - Engine::TILED only recomputes the tiles of the Grid that changed, or are next to a tile that changed.
+ *      - Engine::LOOKUP steps 2x2 blocks of cells at once by looking their 4x4 neighbourhood up in a table.
+ *      - Engine::SIMD sums the neighbours of 16 or 32 cells of the Grid per vector instruction.
+ *      - Engine::TEMPORAL advances each tile of the Grid several generations while it is in cache.
+ */
+enum Engine {
+    NAIVE,
+    BITWISE,
+    WINDOW,
+    PARALLEL,
+    HASHLIFE,
+    TILED,
+    LOOKUP,
+    SIMD,
+    TEMPORAL
+};
+
+/**
+ * A Cycle describes where a World started repeating itself.
+ *      - period is the number of generations between repeats, or 0 if no repeat was found.
+ *      - first is the first generation of the cycle, counted from the start of the search, or -1 if none was found.
+ */
+struct Cycle {
+    int period;
+    int first;
+};
+
+/**
+ * A Change is a cell that was born or died in the last step of a World.
+ *      - x and y are the coordinates of the cell.
+ *      - born is true if the cell came alive, false if it died.
+ */
+struct Change {
+    int x;
+    int y;
+    bool born;
+};
+
 /**
  * Declare the structure of the World class for representing a 2d grid world.
  *
  * A World holds two equally sized Grid objects for the current state and next state.
  *      - These buffers should be swapped using std::swap after each update step.
+ *      - With Engine::NAIVE the two buffers are padded with a one cell halo instead.
+ *      - With Engine::BITWISE the two buffers are BitGrid objects instead, and no byte Grid is allocated.
+ *      - With Engine::HASHLIFE the world is a window onto an unbounded HashLife plane instead.
+ *
+ * A World can also keep a History of its recent generations, which is off until given a byte budget.
+ * Engine::PARALLEL can also run in a NUMA mode, placing each band of rows on the node of the thread stepping it.
  */
 class World {
     // How to draw an owl:
@@ -30,27 +94,122 @@ class World {
     int total_cells;
     int alive_cells;
     int dead_cells;
+    int64_t generation;
+    bool toroidal;
     Grid currState;
     Grid newState;
+    Engine engine;
+    Rule rule;
+    BitGrid currBits;
+    BitGrid newBits;
+    std::shared_ptr<ThreadPool> pool;
+    std::vector<int> bandAlive;
+    bool numa;
+    std::weak_ptr<const void> placed[2];
+    HashLife life;
+    std::vector<char> tileChanged;
+    std::vector<char> tileNextChanged;
+    std::vector<int> tileAlive;
+    bool tileToroidal;
+    Rule tileRule;
+    std::vector<uint8_t> lookupTable;
+    Rule lookupRule;
+    std::vector<uint8_t> lookupColumns;
+    std::vector<Cell> lookupSpare;
+    std::vector<uint8_t> simdShadow;
+    std::vector<uint8_t> simdColumns;
+    std::vector<Cell> currHalo;
+    std::vector<Cell> newHalo;
+    std::vector<uint8_t> blockCells;
+    std::vector<uint8_t> blockNext;
+    std::vector<int> blockColumns;
+    std::vector<uint8_t> blockSums;
+    Grid viewState;
+    History history;
+    std::vector<uint8_t> historyPacked;
+    bool trackChanges;
+    std::vector<Change> changes;
+    std::vector<std::vector<Change>> bandChanges;
 
-    int count_neighbours(int x, int y, bool toroidal);
+    int count_neighbours(int x, int y);
+    void fill_halo(bool toroidal);
+    const Grid& view_state();
+    void pack_state(std::vector<uint8_t>& packed) const;
+    static Grid unpack_state(const uint8_t* packed, int width, int height);
+    void record_history();
+    World snapshot();
+    void step_engine(bool toroidal);
+    void load_state(const Grid& state);
+    void step_bitwise(bool toroidal);
+    template <typename Transition> void step_bitwise(bool toroidal, const Transition& transition);
+    int step_rows(int y0, int y1, bool toroidal, std::vector<Change>* changes);
+    int step_rect(int x0, int y0, int x1, int y1, bool toroidal, bool* changed, std::vector<Change>* changes);
+    void diff_state(const Grid& before);
+    void step_tiled(bool toroidal);
+    void step_parallel(bool toroidal);
+    bool is_placed(const Grid& state) const;
+    void place_bands();
+    void build_lookup();
+    void step_lookup(bool toroidal);
+    void step_simd(bool toroidal);
+    void step_temporal(int generations, bool toroidal);
+    void advance_hashlife(int steps, bool toroidal);
   public:
+    static constexpr int TILE_SIZE = 64;
+    static constexpr int CYCLE_HISTORY = 1024;
+    static constexpr int TEMPORAL_DEPTH = 8;
+    static constexpr uint32_t CHECKPOINT_MAGIC = 0x57474F4C;
+    static constexpr int CHECKPOINT_VERSION = 1;
+    static constexpr int HISTORY_INTERVAL = 64;
+
     World();
     World(int size);
     World(int width, int height);
     World(Grid grid);
+    World(Grid grid, Engine engine);
     int get_height() const;
     int get_width() const;
     int get_total_cells() const;
     int get_alive_cells() const;
     int get_dead_cells() const;
+    int64_t get_generation() const;
+    bool get_toroidal() const;
     void resize(int square_size);
     void resize(int new_width, int new_height);
     Grid get_state() const;
+    GridView view();
+    Engine get_engine() const;
+    void set_engine(Engine engine);
+    Rule get_rule() const;
+    void set_rule(const Rule& rule);
+    int get_threads() const;
+    void set_threads(int threads);
+    bool get_numa() const;
+    void set_numa(bool numa);
+    std::vector<size_t> get_placement() const;
     void step(bool toroidal);
     void step();
     void advance(int steps, bool toroidal);
     void advance(int steps);
+    Cycle advance_until_stable(int max_steps, bool toroidal);
+    Cycle advance_until_stable(int max_steps);
+    void checkpoint(std::ostream& stream) const;
+    void checkpoint(std::string path) const;
+    void restore(std::istream& stream);
+    void restore(std::string path);
+    void set_history(size_t budget, int interval);
+    void set_history(size_t budget);
+    size_t get_history_used() const;
+    int64_t get_history_first() const;
+    Grid state_at(int64_t generation) const;
+    void rewind(int steps);
+    bool get_track_changes() const;
+    void set_track_changes(bool track);
+    const std::vector<Change>& get_changes() const;
+#if defined(__cpp_impl_coroutine)
+    Generator<const Grid&> generations(bool toroidal);
+    Generator<const Grid&> generations();
+#endif
     ~World();
 
 
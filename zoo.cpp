@@ -34,6 +34,7 @@
 #include <bitset>
 #include <cstring>
 #include <algorithm>
+#include <limits>
 
 /**
  * Zoo::glider()
@@ -182,6 +183,10 @@ Grid Zoo::load_ascii(std::string path){
     if (length!=width){
       throw "NOPE";
     }
+    //If there are more lines than the height, throw it
+    if (y>=height){
+      throw "NOPE";
+    }
     for (int x=0; x<width; x++){
       if (line[x]==' '){}
       else if (line[x]=='#'){
@@ -221,13 +226,13 @@ Grid Zoo::load_ascii(std::string path){
  *      The std::string path to the file to write to.
  *
  * @param grid
- *      The grid to be written out to file.
+ *      The grid, or a view of one, to be written out to file. It is read in place, not copied.
  *
  * @throws
  *      Throws std::runtime_error or sub-class if the file cannot be opened.
  */
 
-void Zoo::save_ascii(std::string path, Grid grid){
+void Zoo::save_ascii(std::string path, const GridView& grid){
   std::ofstream outfile;
 
   outfile.open(path);
@@ -281,67 +286,52 @@ void Zoo::save_ascii(std::string path, Grid grid){
  *      Throws std::runtime_error or sub-class if:
  *          - The file cannot be opened.
  *          - The file ends unexpectedly.
+ *          - The header gives a negative size, or more cells than a grid can hold.
  */
 
 Grid Zoo::load_binary(std::string path){
-  std::streampos size;
-  int width=0;
-  int height=0;
-  std::stringstream stream;
-
   std::ifstream file(path, std::ios::binary);
   if (!file) {
-    file.close();
     throw "Binary file not found"; // terminate with error
   }
-  if (file) {
-    // get length of file:
-    file.seekg (0, file.end);
-    int length = file.tellg();
-    file.seekg (0, file.beg);
-    char* buffer=new char [length];
-    // read data as a block:
-    file.read (buffer,length);
-    for (int i=3; i>=0; i--){
-      width+=(int) (buffer[i]);
-    }
-    for (int i=7; i>=4; i--){
-      height+=(int) (buffer[i]);
-    }
-    Grid g(width, height);
-    for (int i=8; i<length; i++){
-      std::string s=std::bitset<8>(buffer[i]).to_string();
-      int n=s.length();
-      for (int j=n-1; j>=0; j--){
-        stream<<s[j];
-      }
-    }
-    const std::string observed = stream.str();
-    //If there are not enough bits, it's malformed
-    int numCells=height*width;
-    int bitLength=observed.length();
-    if (bitLength<numCells){
-      delete [] buffer;
-      file.close();
-      throw "Malformed data";
-    }
-    int v=0;
-    for (int i=0; i<height; i++){
-      for (int j=0; j<width; j++){
-        if (observed[v]=='1'){
-          g.set(j, i, Cell::ALIVE);
-        }
-        v++;
+  // get length of file:
+  file.seekg(0, file.end);
+  int length=file.tellg();
+  file.seekg(0, file.beg);
+  std::vector<unsigned char> buffer(std::max(length, 8));
+  file.read((char*)buffer.data(), length);
+  file.close();
+  if (length<8){
+    throw "Malformed data";
+  }
+  //The width and height are 4 byte little endian integers
+  int width=0;
+  int height=0;
+  for (int i=3; i>=0; i--){
+    width=(width<<8)|buffer[i];
+    height=(height<<8)|buffer[i+4];
+  }
+  //Negative sizes, or more cells than a Grid can count, are malformed
+  long long numCells=(long long)height*width;
+  if (width<0 || height<0 || numCells>std::numeric_limits<int>::max()){
+    throw "Malformed data";
+  }
+  //If there are not enough bits, it's malformed
+  if ((long long)(length-8)*8<numCells){
+    throw "Malformed data";
+  }
+  //Cells follow row by row, 8 to a byte with the first cell in the lowest bit
+  Grid g(width, height);
+  long long v=0;
+  for (int i=0; i<height; i++){
+    for (int j=0; j<width; j++){
+      if ((buffer[8+v/8]>>(v%8))&1){
+        g.set(j, i, Cell::ALIVE);
       }
+      v++;
     }
-    file.close();
-    delete [] buffer;
-    return g;
-  }
-  else{
-    file.close();
-    return 0;
   }
+  return g;
 }
 
 /**
@@ -367,12 +357,12 @@ Grid Zoo::load_binary(std::string path){
  *      The std::string path to the file to write to.
  *
  * @param grid
- *      The grid to be written out to file.
+ *      The grid, or a view of one, to be written out to file. It is read in place, not copied.
  *
  * @throws
  *      Throws std::runtime_error or sub-class if the file cannot be opened.
  */
-void Zoo::save_binary(std::string path, Grid g){
+void Zoo::save_binary(std::string path, const GridView& g){
   std::ofstream outfile;
 
   outfile.open(path);
@@ -27,8 +27,8 @@ namespace Zoo {
     Grid r_pentomino();
     Grid light_weight_spaceship();
     Grid load_ascii(std::string path);
-    void save_ascii(std::string path, Grid grid);
+    void save_ascii(std::string path, const GridView& grid);
     Grid load_binary(std::string path);
-    void save_binary(std::string path, Grid grid);
+    void save_binary(std::string path, const GridView& grid);
 
 };